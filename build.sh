@@ -4,7 +4,12 @@ set -xe
 
 clang                                                         \
 	-Wall -Wextra -g -I./build/ -I./raylib/raylib-5.0/src/    \
-	-o ./build/main ./src/main.c                              \
+	-o ./build/main ./src/main.c ./src/position.c             \
+	./src/attacks.c ./src/movegen.c ./src/zobrist.c           \
+	./src/attackmap.c ./src/termination.c                     \
+	./src/search.c ./src/eval.c ./src/movepick.c ./src/tt.c   \
+	./src/numa.c ./src/see.c ./src/ordering.c                 \
+	./src/spsc.c ./src/thinker.c                              \
 	./build/raylib/macos/libraylib.a                          \
 	-framework CoreVideo                                      \
 	-framework IOKit                                          \
@@ -12,3 +17,30 @@ clang                                                         \
 	-framework GLUT                                           \
 	-framework OpenGL                                         \
 	-lm -ldl -lpthread
+
+clang                                                         \
+	-Wall -Wextra -g -O3 -march=native                        \
+	-o ./build/perft ./src/perft.c ./src/position.c           \
+	./src/attacks.c ./src/movegen.c ./src/pool.c              \
+	./src/zobrist.c ./src/movepick.c ./src/attackmap.c        \
+	./src/numa.c                                              \
+	-lm -lpthread
+
+clang                                                         \
+	-Wall -Wextra -g -O3 -march=native                        \
+	-o ./build/bench ./src/bench.c ./src/position.c           \
+	./src/attacks.c ./src/zobrist.c ./src/fill.c              \
+	./src/movegen.c ./src/pool.c ./src/batch.c                \
+	./src/attackmap.c ./src/termination.c                     \
+	./src/search.c ./src/eval.c ./src/movepick.c ./src/tt.c   \
+	./src/numa.c ./src/see.c ./src/ordering.c                 \
+	-lm -lpthread
+
+clang                                                         \
+	-Wall -Wextra -g -O3 -march=native                        \
+	-o ./build/engine ./src/engine.c ./src/search.c           \
+	./src/eval.c ./src/position.c ./src/attacks.c             \
+	./src/movegen.c ./src/movepick.c ./src/zobrist.c          \
+	./src/termination.c ./src/tt.c ./src/numa.c ./src/see.c   \
+	./src/ordering.c                                          \
+	-lm -lpthread
@@ -0,0 +1,54 @@
+#include <string.h>
+
+#include "attackmap.h"
+#include "attacks.h"
+
+static void set_attacks(Attack_Map *map, Square sq, Bitboard attacks) {
+	Bitboard bit = BB_SQUARE(sq);
+	Square target;
+	BB_FOREACH(target, map->attacks_from[sq] ^ attacks) map->attacks_to[target] ^= bit;
+	map->attacks_from[sq] = attacks;
+}
+
+static Bitboard square_attacks(const Position *position, Square sq) {
+	Piece piece = position_at(position, sq);
+	return piece_is_empty(piece)? BB_EMPTY: attacks_piece(piece, sq, position->occupied);
+}
+
+// Every square whose content move changes, which is the same before and after it is made
+static Bitboard move_touched(const Position *position, Move move) {
+	Square from = move_from(move), to = move_to(move);
+	Bitboard touched = BB_SQUARE(from) | BB_SQUARE(to);
+	switch (move_kind(move)) {
+	case MOVE_EN_PASSANT: {
+		touched |= BB_SQUARE(SQUARE(SQUARE_ROW(from), SQUARE_COL(to)));
+		break;
+	}
+	case MOVE_CASTLING: {
+		// The rook starts where it always does on that side, whatever rights are left afterwards
+		Square rook = position->castling_rooks[(SQUARE_ROW(from) == 0? 2: 0) + (to > from)];
+		touched |= BB_SQUARE(rook) | BB_SQUARE(to > from? to-1: to+1);
+		break;
+	}
+	case MOVE_NORMAL:
+	case MOVE_DOUBLE_MOVE:
+	case MOVE_PROMOTION: break;
+	}
+	return touched;
+}
+
+void attack_map_init(Attack_Map *map, const Position *position) {
+	memset(map, 0, sizeof(*map));
+	Square sq;
+	BB_FOREACH(sq, position->occupied) set_attacks(map, sq, square_attacks(position, sq));
+}
+
+void attack_map_update(Attack_Map *map, const Position *position, Move move) {
+	Bitboard touched = move_touched(position, move);
+	Bitboard sliders = position->by_type[TYPE_ROOK] | position->by_type[TYPE_BISHOP] | position->by_type[TYPE_QUEEN];
+	// A slider whose view changed was looking at one of the touched squares, whether it was blocked there or passed through
+	Bitboard affected = touched;
+	Square sq;
+	BB_FOREACH(sq, touched) affected |= map->attacks_to[sq] & sliders;
+	BB_FOREACH(sq, affected) set_attacks(map, sq, square_attacks(position, sq));
+}
@@ -0,0 +1,33 @@
+#ifndef ATTACKMAP_H_
+#define ATTACKMAP_H_
+
+#include "movegen.h"
+
+/*
+	What every piece attacks, and for every square which pieces attack it, kept up to date as
+	moves are made and taken back instead of being worked out from the bitboards every time it is
+	needed. A move only changes the attacks of the pieces on the squares it touches and of the
+	sliders that were looking at those squares, so only those are recomputed. Whether that beats
+	recomputing depends on how much attack information a node uses, so it is kept separate from
+	Position and only maintained by whoever wants it. For now that is only perft -attacks map,
+	through generate_legal_mapped: in perft the updates cost more than they save, so the search,
+	position_checkers and see_ge keep working attacks out from the bitboards.
+*/
+struct Attack_Map {
+	Bitboard attacks_from[BOARD_LEN]; // attacks of the piece on each square, empty if there is none
+	Bitboard attacks_to[BOARD_LEN]; // squares of the pieces of either side that attack each square
+};
+
+void attack_map_init(Attack_Map *map, const Position *position);
+// Has to be called after position_make_move of move, and again after its position_unmake_move
+void attack_map_update(Attack_Map *map, const Position *position, Move move);
+
+static inline Bitboard attack_map_attackers(const Attack_Map *map, Square sq) {
+	return map->attacks_to[sq];
+}
+
+static inline bool attack_map_is_attacked(const Attack_Map *map, const Position *position, Square sq, Piece_Owner by) {
+	return (map->attacks_to[sq] & position->by_owner[by]) != BB_EMPTY;
+}
+
+#endif // ATTACKMAP_H_
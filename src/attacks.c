@@ -0,0 +1,208 @@
+#include <assert.h>
+
+#include "attacks.h"
+
+Bitboard knight_table[BOARD_LEN];
+Bitboard king_table[BOARD_LEN];
+Bitboard pawn_table[OWNER_COUNT][BOARD_LEN];
+Bitboard between_table[BOARD_LEN][BOARD_LEN];
+Bitboard line_table[BOARD_LEN][BOARD_LEN];
+
+#if BB_WIDE
+Bitboard ray_table[RAY_DIRECTIONS][BOARD_LEN];
+
+static void init_rays(Bitboard *rays, int8_t left, int8_t up) {
+	int8_t dirs[4][2] = {{left, up}, {-up, left}, {-left, -up}, {up, -left}};
+	for (int i = 0; i < 4; ++i) {
+		for (Square sq = 0; sq < BOARD_LEN; ++sq) rays[i*BOARD_LEN + sq] = line_attacks(sq, BB_EMPTY, dirs[i][0], dirs[i][1], MAX(COLS, ROWS));
+	}
+}
+#else
+// Table sizes for 8x8 boards, smaller boards need less
+#define ROOK_TABLE_LEN 0x19000
+#define BISHOP_TABLE_LEN 0x1480
+#define MAX_MAGIC_BITS 12
+
+Magic rook_magics[BOARD_LEN];
+Magic bishop_magics[BOARD_LEN];
+
+static Bitboard rook_table[ROOK_TABLE_LEN];
+static Bitboard bishop_table[BISHOP_TABLE_LEN];
+
+#ifndef __BMI2__
+// xorshift64*, seeded with a constant so the magics come out the same on every run
+static uint64_t magic_rand_state = 0x9E3779B97F4A7C15ull;
+static uint64_t magic_rand(void) {
+	magic_rand_state ^= magic_rand_state >> 12;
+	magic_rand_state ^= magic_rand_state << 25;
+	magic_rand_state ^= magic_rand_state >> 27;
+	return magic_rand_state * 0x2545F4914F6CDD1Dull;
+}
+
+#if COLS == 8 && ROWS == 8
+// Found by the search below, stored so that startup does not have to repeat it
+static const Bitboard rook_magic_numbers[BOARD_LEN] = {
+	0x1080004008801020ull, 0x0840092002C03000ull, 0x1900200010400900ull, 0x0880100008000480ull,
+	0x4200100420080200ull, 0x8100020100080400ull, 0x0200040110886200ull, 0x0200008040220411ull,
+	0x0404800084400220ull, 0x0000401000402000ull, 0x0086001081220440ull, 0x0408800800100280ull,
+	0x000A001201040820ull, 0x8848800200840080ull, 0x4001000100040200ull, 0x0442000102105084ull,
+	0x9080010020804100ull, 0x0040404000201009ull, 0x0000808010002009ull, 0x2200090021D00100ull,
+	0x0008008008040080ull, 0x0004004002010040ull, 0x0011040008015042ull, 0x00000A0001768104ull,
+	0x0000800080204009ull, 0x2010004140002001ull, 0x9800200280100080ull, 0x1000100080080080ull,
+	0x0442000A00049020ull, 0x2100040080020080ull, 0x0800120400900148ull, 0x0010040A00128541ull,
+	0x2800804000800030ull, 0x1010002000400041ull, 0x4000200011004100ull, 0x0610008410800800ull,
+	0x0400802402800800ull, 0xC100020080800400ull, 0x0002000802000401ull, 0x0182085882000401ull,
+	0x0220204000808000ull, 0x2860100040024022ull, 0x0001002004110040ull, 0x99101042000A0020ull,
+	0x0004080004008080ull, 0x0010040002008080ull, 0x2012004881020004ull, 0x8300842444820011ull,
+	0x0088403882010200ull, 0x0820400080210100ull, 0x0110910040A00300ull, 0x0801100280080480ull,
+	0x0242009008200600ull, 0x1002000489500200ull, 0x0040800200010080ull, 0x0091800041000080ull,
+	0x0000209300488001ull, 0x04C1002414824001ull, 0x020020000B001041ull, 0x7000100004200901ull,
+	0x8002002004100802ull, 0x30010002084C0007ull, 0x0888221800813004ull, 0x4000002840840112ull,
+};
+static const Bitboard bishop_magic_numbers[BOARD_LEN] = {
+	0x8210103483004200ull, 0x0008022802002820ull, 0x0404810401000010ull, 0x4004043280808044ull,
+	0x0181104004600101ull, 0x8802021104000000ull, 0x000111011041A000ull, 0x4000420890211000ull,
+	0x3200109001080880ull, 0x0002E0810A0A0840ull, 0x2040840802004228ull, 0x9200110408800000ull,
+	0x0000C45040020100ull, 0x0200088824401000ull, 0x0000110690104804ull, 0x04010A4400A41006ull,
+	0x01C100D03001A100ull, 0x9820220481020A00ull, 0x520D263000420040ull, 0x0180810802004102ull,
+	0x0002001016100000ull, 0x0200800808010828ull, 0x0002402C88081800ull, 0x4018400A82009080ull,
+	0x441005010A200402ull, 0x4024041143880802ull, 0x0200280210004940ull, 0xA201004024004200ull,
+	0x8000840184802000ull, 0x0800820080880C00ull, 0x1008004821040202ull, 0x0000921019820280ull,
+	0x0102084100045001ull, 0xA590820820200802ull, 0x0104020200010409ull, 0x0000A00800210106ull,
+	0x0001020401020102ull, 0x0508080021011000ull, 0x0058162850140100ull, 0x0002040020004212ull,
+	0x000801108A001000ull, 0x0A408090100008C2ull, 0x0000101804002800ull, 0x0000004200821800ull,
+	0x0020049008800401ull, 0x02C8015004080480ull, 0x8804014414000110ull, 0x0008011042000080ull,
+	0x04010C8290400010ull, 0x0382048208232402ull, 0x1000202108080140ull, 0x008000120A020100ull,
+	0x108C0011A2020004ull, 0x010004200421100Eull, 0x8820200409105000ull, 0x0108300400802840ull,
+	0x0402008049282000ull, 0x0000002402080480ull, 0x08001C0422017001ull, 0x000200001420A801ull,
+	0x2010C20011020204ull, 0x3000308461444500ull, 0x1000040404C80200ull, 0x0825011019060080ull,
+};
+#else
+#define rook_magic_numbers NULL
+#define bishop_magic_numbers NULL
+#endif
+#endif
+
+// Squares on the edge of the board never block anything further along the ray, so they are left out
+static Bitboard relevant_mask(Square sq, int8_t left, int8_t up) {
+	Bitboard mask = BB_EMPTY;
+	int8_t dirs[4][2] = {{left, up}, {-up, left}, {-left, -up}, {up, -left}};
+	for (int i = 0; i < 4; ++i) {
+		int8_t dx = dirs[i][0], dy = dirs[i][1];
+		Bitboard edge = BB_EMPTY;
+		if (dx > 0) edge |= BB_COL(COLS-1);
+		if (dx < 0) edge |= BB_COL(0);
+		if (dy > 0) edge |= BB_ROW(ROWS-1);
+		if (dy < 0) edge |= BB_ROW(0);
+		mask |= line_attacks(sq, BB_EMPTY, dx, dy, MAX(COLS, ROWS)) & ~edge;
+	}
+	return mask;
+}
+
+static void init_sliders(Magic *magics, Bitboard *table, size_t table_len, const Bitboard *magic_numbers, int8_t left, int8_t up) {
+	static Bitboard occupancies[1 << MAX_MAGIC_BITS];
+	static Bitboard references[1 << MAX_MAGIC_BITS];
+#ifndef __BMI2__
+	static int epochs[1 << MAX_MAGIC_BITS];
+	static int epoch = 0;
+#endif
+	size_t offset = 0;
+
+	for (Square sq = 0; sq < BOARD_LEN; ++sq) {
+		Magic *magic = &magics[sq];
+		magic->mask = relevant_mask(sq, left, up);
+		int bits = bb_count(magic->mask);
+		assert(bits <= MAX_MAGIC_BITS);
+		magic->shift = 64 - bits;
+		magic->attacks = table + offset;
+		size_t size = (size_t)1 << bits;
+		assert(offset + size <= table_len);
+
+		// Carry-rippler trick to enumerate every subset of the mask
+		size_t count = 0;
+		Bitboard occupied = BB_EMPTY;
+		do {
+			occupancies[count] = occupied;
+			references[count] = lines_attacks(sq, occupied, left, up, MAX(COLS, ROWS));
+			++count;
+			occupied = (occupied - magic->mask) & magic->mask;
+		} while (occupied);
+
+#ifdef __BMI2__
+		for (size_t i = 0; i < count; ++i) magic->attacks[magic_index(magic, occupancies[i])] = references[i];
+#else
+		for (bool found = false; !found;) {
+			if (magic_numbers) magic->magic = magic_numbers[sq];
+			else do magic->magic = magic_rand() & magic_rand() & magic_rand();
+			while (bb_count((magic->mask * magic->magic) >> 56) < 6);
+
+			++epoch;
+			found = true;
+			for (size_t i = 0; i < count && found; ++i) {
+				size_t idx = magic_index(magic, occupancies[i]);
+				if (epochs[idx] < epoch) {
+					epochs[idx] = epoch;
+					magic->attacks[idx] = references[i];
+				} else if (magic->attacks[idx] != references[i]) {
+					found = false;
+				}
+			}
+			assert((found || !magic_numbers) && "Stored magic number does not work");
+		}
+#endif
+		offset += size;
+	}
+	(void)table_len;
+	(void)magic_numbers;
+}
+#endif
+
+static void init_lines(int8_t left, int8_t up) {
+	int8_t dirs[4][2] = {{left, up}, {-up, left}, {-left, -up}, {up, -left}};
+	for (Square a = 0; a < BOARD_LEN; ++a) {
+		for (int i = 0; i < 4; ++i) {
+			int8_t dx = dirs[i][0], dy = dirs[i][1];
+			Bitboard ray = line_attacks(a, BB_EMPTY, dx, dy, MAX(COLS, ROWS));
+			Bitboard line = ray | line_attacks(a, BB_EMPTY, -dx, -dy, MAX(COLS, ROWS)) | BB_SQUARE(a);
+			Square b;
+			BB_FOREACH(b, ray) {
+				between_table[a][b] = line_attacks(a, BB_SQUARE(b), dx, dy, MAX(COLS, ROWS)) & ~BB_SQUARE(b);
+				line_table[a][b] = line;
+			}
+		}
+	}
+}
+
+void attacks_init(void) {
+	for (Square sq = 0; sq < BOARD_LEN; ++sq) {
+		knight_table[sq] = knight_attacks(BB_SQUARE(sq));
+		king_table[sq] = king_attacks(BB_SQUARE(sq));
+		pawn_table[OWNER_WHITE][sq] = pawn_attacks(BB_SQUARE(sq), OWNER_WHITE);
+		pawn_table[OWNER_BLACK][sq] = pawn_attacks(BB_SQUARE(sq), OWNER_BLACK);
+	}
+#if BB_WIDE
+	init_rays(ray_table[0], 1, 0);
+	init_rays(ray_table[4], 1, 1);
+#elif defined(__BMI2__)
+	init_sliders(rook_magics, rook_table, ROOK_TABLE_LEN, NULL, 1, 0);
+	init_sliders(bishop_magics, bishop_table, BISHOP_TABLE_LEN, NULL, 1, 1);
+#else
+	init_sliders(rook_magics, rook_table, ROOK_TABLE_LEN, rook_magic_numbers, 1, 0);
+	init_sliders(bishop_magics, bishop_table, BISHOP_TABLE_LEN, bishop_magic_numbers, 1, 1);
+#endif
+	init_lines(1, 0);
+	init_lines(1, 1);
+}
+
+Bitboard attacks_piece(Piece piece, Square sq, Bitboard occupied) {
+	switch (piece.type) {
+	case TYPE_NONE:   return BB_EMPTY;
+	case TYPE_KING:   return attacks_king(sq);
+	case TYPE_QUEEN:  return attacks_queen(sq, occupied);
+	case TYPE_BISHOP: return attacks_bishop(sq, occupied);
+	case TYPE_KNIGHT: return attacks_knight(sq);
+	case TYPE_ROOK:   return attacks_rook(sq, occupied);
+	case TYPE_PAWN:   return attacks_pawn(piece.owner, sq);
+	}
+	return BB_EMPTY;
+}
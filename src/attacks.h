@@ -0,0 +1,108 @@
+#ifndef ATTACKS_H_
+#define ATTACKS_H_
+
+#include "position.h"
+
+#if defined(__BMI2__) && !BB_WIDE
+#include <immintrin.h>
+#endif
+
+#if BB_WIDE
+/*
+	No multiply or PEXT covers a board wider than 64 squares, so sliders use the classical approach:
+	the ray in each direction on an empty board, cut off behind the first blocker. Rays are stored in
+	the order of the (1,0) and (1,1) rotations, where the first two of each point to higher squares
+	and so meet their first blocker at its lowest bit, and the other two at its highest.
+*/
+#define RAY_DIRECTIONS 8
+extern Bitboard ray_table[RAY_DIRECTIONS][BOARD_LEN];
+#else
+/*
+	Sliding attacks are looked up from the occupancy of the squares that can block a ray.
+	With BMI2 the index is a PEXT of those squares, otherwise it is a "fancy" magic multiply
+	and shift, so an attack set is always a handful of instructions and one load.
+*/
+typedef struct {
+	Bitboard mask;
+	Bitboard magic;
+	Bitboard *attacks;
+	uint8_t shift;
+} Magic;
+
+extern Magic rook_magics[BOARD_LEN];
+extern Magic bishop_magics[BOARD_LEN];
+#endif
+extern Bitboard knight_table[BOARD_LEN];
+extern Bitboard king_table[BOARD_LEN];
+extern Bitboard pawn_table[OWNER_COUNT][BOARD_LEN];
+extern Bitboard between_table[BOARD_LEN][BOARD_LEN];
+extern Bitboard line_table[BOARD_LEN][BOARD_LEN];
+
+// Has to be called once before any of the lookups below
+void attacks_init(void);
+
+#if BB_WIDE
+static inline Bitboard ray_attacks(int dir, Square sq, Bitboard occupied) {
+	Bitboard ray = ray_table[dir][sq];
+	Bitboard blockers = ray & occupied;
+	if (!blockers) return ray;
+	return ray ^ ray_table[dir][(dir & 2)? bb_last(blockers): bb_first(blockers)];
+}
+
+static inline Bitboard attacks_rook(Square sq, Bitboard occupied) {
+	return ray_attacks(0, sq, occupied) | ray_attacks(1, sq, occupied) | ray_attacks(2, sq, occupied) | ray_attacks(3, sq, occupied);
+}
+
+static inline Bitboard attacks_bishop(Square sq, Bitboard occupied) {
+	return ray_attacks(4, sq, occupied) | ray_attacks(5, sq, occupied) | ray_attacks(6, sq, occupied) | ray_attacks(7, sq, occupied);
+}
+#else
+static inline size_t magic_index(const Magic *magic, Bitboard occupied) {
+#ifdef __BMI2__
+	return _pext_u64(occupied, magic->mask);
+#else
+	return ((occupied & magic->mask) * magic->magic) >> magic->shift;
+#endif
+}
+
+static inline Bitboard attacks_rook(Square sq, Bitboard occupied) {
+	const Magic *magic = &rook_magics[sq];
+	return magic->attacks[magic_index(magic, occupied)];
+}
+
+static inline Bitboard attacks_bishop(Square sq, Bitboard occupied) {
+	const Magic *magic = &bishop_magics[sq];
+	return magic->attacks[magic_index(magic, occupied)];
+}
+#endif
+
+static inline Bitboard attacks_queen(Square sq, Bitboard occupied) {
+	return attacks_rook(sq, occupied) | attacks_bishop(sq, occupied);
+}
+
+static inline Bitboard attacks_knight(Square sq) {
+	return knight_table[sq];
+}
+
+static inline Bitboard attacks_king(Square sq) {
+	return king_table[sq];
+}
+
+static inline Bitboard attacks_pawn(Piece_Owner colour, Square sq) {
+	return pawn_table[colour][sq];
+}
+
+// Squares strictly between a and b when they share a row, column or diagonal, empty otherwise
+static inline Bitboard squares_between(Square a, Square b) {
+	return between_table[a][b];
+}
+
+// The whole row, column or diagonal through a and b (both included), empty if they do not share one
+static inline Bitboard squares_line(Square a, Square b) {
+	return line_table[a][b];
+}
+
+// Attacks of a piece of the given type standing on sq, TYPE_PAWN needs the colour
+Bitboard attacks_piece(Piece piece, Square sq, Bitboard occupied);
+
+#endif // ATTACKS_H_
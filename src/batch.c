@@ -0,0 +1,116 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+
+#include "batch.h"
+
+// Waits until every chunk before this one is in the output
+static void batch_wait_turn(Batch *batch, size_t chunk) {
+	// Chunks are claimed in order and never given up, so the one before this is always being worked on
+	while (atomic_load_explicit(&batch->committed_chunks, memory_order_acquire) != chunk) sched_yield();
+}
+
+// Appends moves to the output as the moves of position i, false if they do not fit
+static bool batch_append(Batch *batch, size_t i, const Move *moves, size_t len) {
+	if (batch->overflow || batch->moves_len + len > batch->moves_cap) {
+		batch->overflow = true;
+		return false;
+	}
+	memcpy(batch->moves + batch->moves_len, moves, len*sizeof(Move));
+	batch->moves_len += len;
+	batch->offsets[i+1] = batch->moves_len;
+	return true;
+}
+
+// With every earlier chunk in, the moves go straight to where they belong
+static void batch_generate_direct(Batch *batch, size_t start, size_t end) {
+	for (size_t i = start; i < end && !batch->overflow; ++i) {
+		if (batch->moves_len + MAX_MOVES <= batch->moves_cap) {
+			batch->moves_len = generate_legal_into(&batch->positions[i], batch->moves + batch->moves_len) - batch->moves;
+			batch->offsets[i+1] = batch->moves_len;
+		} else {
+			// Near the end of the output there may not be room for as many moves as a position can have
+			Move_List list;
+			generate_legal(&batch->positions[i], &list);
+			batch_append(batch, i, list.moves, list.len);
+		}
+	}
+}
+
+/*
+	Ahead of its turn, the chunk is generated packed into scratch, with the offsets of its
+	positions relative to scratch kept in the output offsets for now, and is copied in one go.
+*/
+static void batch_generate_scratch(Batch *batch, size_t chunk, Move *scratch, size_t start, size_t end) {
+	Move *it = scratch;
+	for (size_t i = start; i < end; ++i) {
+		it = generate_legal_into(&batch->positions[i], it);
+		batch->offsets[i+1] = it - scratch;
+	}
+
+	batch_wait_turn(batch, chunk);
+	size_t offset = batch->moves_len;
+	if (!batch->overflow && offset + (it - scratch) <= batch->moves_cap) {
+		memcpy(batch->moves + offset, scratch, (it - scratch)*sizeof(Move));
+		for (size_t i = start; i < end; ++i) batch->offsets[i+1] += offset;
+		batch->moves_len = offset + (it - scratch);
+		return;
+	}
+	// Only the positions that still fit whole go in
+	size_t from = 0;
+	for (size_t i = start; i < end; ++i) {
+		size_t to = batch->offsets[i+1];
+		if (!batch_append(batch, i, scratch + from, to - from)) break;
+		from = to;
+	}
+}
+
+static void batch_task_run(Pool_Worker *worker, Task *task) {
+	Batch *batch = ((Batch_Task *)task)->batch;
+	if (task == &batch->tasks[0].task) {
+		// The root hands one loop to every other worker and runs its own
+		for (int i = 1; i < batch->pool.workers_len; ++i) pool_spawn(worker, &batch->tasks[i].task);
+	}
+
+	Move *scratch = &batch->scratch[(size_t)worker->id*BATCH_SCRATCH_LEN];
+	for (;;) {
+		size_t chunk = atomic_fetch_add(&batch->next_chunk, 1);
+		size_t start = chunk*BATCH_CHUNK_LEN;
+		if (start >= batch->positions_len) return;
+		size_t end = start + BATCH_CHUNK_LEN < batch->positions_len? start + BATCH_CHUNK_LEN: batch->positions_len;
+		if (atomic_load_explicit(&batch->committed_chunks, memory_order_acquire) == chunk) batch_generate_direct(batch, start, end);
+		else batch_generate_scratch(batch, chunk, scratch, start, end);
+		worker->nodes += end - start;
+		atomic_store_explicit(&batch->committed_chunks, chunk + 1, memory_order_release);
+	}
+}
+
+void batch_init(Batch *batch, int threads) {
+	memset(batch, 0, sizeof(*batch));
+	pool_init(&batch->pool, threads);
+	batch->scratch = aligned_alloc(CACHE_LINE, (size_t)threads*BATCH_SCRATCH_LEN*sizeof(Move));
+	assert(batch->scratch != NULL);
+	for (int i = 0; i < threads; ++i) batch->tasks[i] = (Batch_Task){{batch_task_run}, batch};
+}
+
+void batch_free(Batch *batch) {
+	pool_free(&batch->pool);
+	free(batch->scratch);
+}
+
+bool batch_generate(Batch *batch, const Position *positions, size_t len, Move *moves, size_t moves_cap, size_t *offsets) {
+	batch->positions = positions;
+	batch->positions_len = len;
+	batch->moves = moves;
+	batch->moves_cap = moves_cap;
+	batch->offsets = offsets;
+	batch->moves_len = 0;
+	batch->overflow = false;
+	atomic_store(&batch->next_chunk, 0);
+	atomic_store(&batch->committed_chunks, 0);
+	offsets[0] = 0;
+
+	pool_run(&batch->pool, &batch->tasks[0].task);
+	return !batch->overflow;
+}
@@ -0,0 +1,52 @@
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include <stddef.h>
+
+#include "movegen.h"
+#include "pool.h"
+
+#define BATCH_CHUNK_LEN 256
+#define BATCH_SCRATCH_LEN (BATCH_CHUNK_LEN*MAX_MOVES) // enough for any chunk, whatever its positions
+
+typedef struct Batch Batch;
+
+typedef struct {
+	Task task;
+	Batch *batch;
+} Batch_Task;
+
+/*
+	Generates the legal moves of a whole array of positions into one flat buffer, split over
+	the threads of a pool. Workers claim chunks of positions in order. A worker whose chunk is
+	next in line, which on a single thread is every chunk, generates it straight into the output.
+	Any other generates it packed into its own scratch buffer and appends it with one copy once
+	every earlier chunk is in. There is one pass over the positions and nothing is allocated per call.
+*/
+struct Batch {
+	Pool pool;
+	Batch_Task tasks[POOL_MAX_WORKERS];
+	Move *scratch; // BATCH_SCRATCH_LEN moves per worker
+
+	// The call in progress
+	const Position *positions;
+	size_t positions_len;
+	Move *moves;
+	size_t moves_cap;
+	size_t *offsets;
+	_Alignas(CACHE_LINE) _Atomic size_t next_chunk;
+	_Alignas(CACHE_LINE) _Atomic size_t committed_chunks;
+	size_t moves_len; // only touched by whoever holds the next commit
+	bool overflow;
+};
+
+void batch_init(Batch *batch, int threads);
+void batch_free(Batch *batch);
+/*
+	The moves of positions[i] end up in moves[offsets[i]..offsets[i+1]), so offsets needs room for
+	len+1 entries. Returns false if moves_cap was too small, in which case only the positions whose
+	offsets[i+1] is at most moves_cap were filled in. len*MAX_MOVES is always enough.
+*/
+bool batch_generate(Batch *batch, const Position *positions, size_t len, Move *moves, size_t moves_cap, size_t *offsets);
+
+#endif // BATCH_H_
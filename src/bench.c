@@ -0,0 +1,333 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "position.h"
+#include "attacks.h"
+#include "fill.h"
+#include "movegen.h"
+#include "batch.h"
+#include "zobrist.h"
+#include "termination.h"
+#include "search.h"
+#include "numa.h"
+
+#define BENCH_OCCUPANCIES 4096
+#define BENCH_ROUNDS 64
+#define BENCH_BATCH (1 << 20)
+#define BENCH_BATCH_TARGET 0.95 // of the single loop's speed per thread that the batch has to keep
+#define BENCH_PLAYOUT_PLIES 60
+#define BENCH_SEARCH_DEPTH 8
+#define BENCH_PRUNING_DEPTH 12 // deep enough that the selective techniques have room to pay off
+#define BENCH_SEARCH_HASH_MB 64
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+static uint64_t bench_rand_state = 0x2545F4914F6CDD1Dull;
+static uint64_t bench_rand(void) {
+	bench_rand_state ^= bench_rand_state >> 12;
+	bench_rand_state ^= bench_rand_state << 25;
+	bench_rand_state ^= bench_rand_state >> 27;
+	return bench_rand_state * 0x2545F4914F6CDD1Dull;
+}
+
+static Bitboard bench_bitboard(void) {
+	Bitboard bb = bench_rand();
+#if BB_WIDE
+	bb |= (Bitboard)bench_rand() << 64;
+#endif
+	return bb;
+}
+
+static Bitboard occupancies[BENCH_OCCUPANCIES];
+
+static void report(const char *name, double count, double seconds, const char *unit) {
+	printf("%-24s %12.0f %s in %6.3fs = %8.2f M%s/s\n", name, count, unit, seconds, count/seconds/1e6, unit);
+}
+
+// Rook and bishop attack sets for every square over a set of random occupancies
+static void bench_attacks(void) {
+	for (int i = 0; i < BENCH_OCCUPANCIES; ++i) occupancies[i] = bench_bitboard() & bench_bitboard() & BB_ALL;
+
+	volatile Bitboard sink = 0;
+	Bitboard acc = 0;
+	double count = 2.0*BENCH_OCCUPANCIES*BOARD_LEN;
+
+	double start = now();
+	for (int i = 0; i < BENCH_OCCUPANCIES; ++i) {
+		for (Square sq = 0; sq < BOARD_LEN; ++sq) {
+			acc ^= lines_attacks(sq, occupancies[i], 1, 0, MAX(COLS, ROWS));
+			acc ^= lines_attacks(sq, occupancies[i], 1, 1, MAX(COLS, ROWS));
+		}
+	}
+	report("attacks/rays", count, now() - start, "attacks");
+
+	start = now();
+	for (int round = 0; round < BENCH_ROUNDS; ++round) {
+		for (int i = 0; i < BENCH_OCCUPANCIES; ++i) {
+			for (Square sq = 0; sq < BOARD_LEN; ++sq) {
+				acc ^= attacks_rook(sq, occupancies[i]);
+				acc ^= attacks_bishop(sq, occupancies[i]);
+			}
+		}
+	}
+#if BB_WIDE
+	report("attacks/classical", count*BENCH_ROUNDS, now() - start, "attacks");
+#elif defined(__BMI2__)
+	report("attacks/pext", count*BENCH_ROUNDS, now() - start, "attacks");
+#else
+	report("attacks/magic", count*BENCH_ROUNDS, now() - start, "attacks");
+#endif
+	sink = acc;
+	(void)sink;
+}
+
+static size_t fill_mismatches(const Bitboard *expected, const Bitboard *attacks) {
+	size_t mismatches = 0;
+	for (size_t i = 0; i < BENCH_BATCH; ++i) mismatches += expected[i] != attacks[i];
+	return mismatches;
+}
+
+// Attack maps of every slider for a batch of random positions too large for the cache
+static void bench_fill(void) {
+	Bitboard *rooks = malloc(BENCH_BATCH*sizeof(Bitboard));
+	Bitboard *bishops = malloc(BENCH_BATCH*sizeof(Bitboard));
+	Bitboard *occupied = malloc(BENCH_BATCH*sizeof(Bitboard));
+	Bitboard *expected = malloc(BENCH_BATCH*sizeof(Bitboard));
+	Bitboard *attacks = malloc(BENCH_BATCH*sizeof(Bitboard));
+	for (size_t i = 0; i < BENCH_BATCH; ++i) {
+		occupied[i] = bench_bitboard() & bench_bitboard() & BB_ALL;
+		rooks[i] = occupied[i] & bench_bitboard() & bench_bitboard();
+		bishops[i] = occupied[i] & bench_bitboard() & bench_bitboard();
+	}
+
+	double start = now();
+	for (size_t i = 0; i < BENCH_BATCH; ++i) {
+		Bitboard result = BB_EMPTY;
+		Square sq;
+		BB_FOREACH(sq, rooks[i]) result |= attacks_rook(sq, occupied[i]);
+		BB_FOREACH(sq, bishops[i]) result |= attacks_bishop(sq, occupied[i]);
+		expected[i] = result;
+	}
+	report("fill/lookup", BENCH_BATCH, now() - start, "positions");
+
+	start = now();
+	fill_attacks_scalar(rooks, bishops, occupied, attacks, BENCH_BATCH);
+	report("fill/kogge-stone", BENCH_BATCH, now() - start, "positions");
+	size_t mismatches = fill_mismatches(expected, attacks);
+
+	if (fill_has_avx2()) {
+		start = now();
+		fill_attacks(rooks, bishops, occupied, attacks, BENCH_BATCH);
+		report("fill/kogge-stone-avx2", BENCH_BATCH, now() - start, "positions");
+		mismatches += fill_mismatches(expected, attacks);
+	}
+	if (mismatches) printf("fill: %zu attack maps differ from the lookups\n", mismatches);
+
+	free(rooks);
+	free(bishops);
+	free(occupied);
+	free(expected);
+	free(attacks);
+}
+
+// Positions from random games, so that they look like the ones a data pipeline would see
+static void random_positions(Position *positions, size_t len) {
+	Position position;
+	int plies = BENCH_PLAYOUT_PLIES;
+	for (size_t i = 0; i < len; ++i) {
+		if (plies == BENCH_PLAYOUT_PLIES) {
+			position_reset(&position);
+			plies = 0;
+		}
+		Move_List moves;
+		generate_legal(&position, &moves);
+		if (moves.len == 0) {
+			plies = BENCH_PLAYOUT_PLIES;
+			--i;
+			continue;
+		}
+		position_make_move(&position, moves.moves[bench_rand() % moves.len]);
+		positions[i] = position;
+		++plies;
+	}
+}
+
+// Legal moves for a large array of positions, one at a time and through the batch API
+static void bench_batch(void) {
+	Position *positions = malloc(BENCH_BATCH*sizeof(Position));
+	size_t *offsets = malloc((BENCH_BATCH+1)*sizeof(size_t));
+	size_t moves_cap = (size_t)BENCH_BATCH*64;
+	Move *moves = malloc(moves_cap*sizeof(Move));
+	random_positions(positions, BENCH_BATCH);
+	// Page faults on the first touch of the output are not what is being measured
+	memset(moves, 0, moves_cap*sizeof(Move));
+
+	double start = now();
+	size_t moves_len = 0;
+	for (size_t i = 0; i < BENCH_BATCH; ++i) {
+		Move_List list;
+		generate_legal(&positions[i], &list);
+		moves_len += list.len;
+	}
+	double seconds = now() - start;
+	double single_seconds = seconds;
+	report("batch/single", BENCH_BATCH, seconds, "positions");
+	report("batch/single", moves_len, seconds, "moves");
+
+	int thread_counts[] = {1, 2, 4, 8, 16, 32, 64};
+	int cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	for (size_t t = 0; t < sizeof(thread_counts)/sizeof(thread_counts[0]) && thread_counts[t] <= cpus; ++t) {
+		Batch *batch = malloc(sizeof(Batch));
+		batch_init(batch, thread_counts[t]);
+		start = now();
+		bool ok = batch_generate(batch, positions, BENCH_BATCH, moves, moves_cap, offsets);
+		seconds = now() - start;
+		char name[32];
+		snprintf(name, sizeof(name), "batch/threads-%d", thread_counts[t]);
+		report(name, BENCH_BATCH, seconds, "positions");
+		double speedup = single_seconds/seconds;
+		printf("%-24s %5.2fx the speed of the single loop, target %.2fx: %s\n", name, speedup, BENCH_BATCH_TARGET*thread_counts[t],
+			speedup >= BENCH_BATCH_TARGET*thread_counts[t]? "met": "missed");
+		if (!ok || offsets[BENCH_BATCH] != moves_len) printf("batch: %zu moves, expected %zu\n", ok? offsets[BENCH_BATCH]: 0, moves_len);
+		batch_free(batch);
+		free(batch);
+	}
+
+	free(positions);
+	free(offsets);
+	free(moves);
+}
+
+// Whether the side to move has any legal move, by full generation and by stopping at the first one
+static void bench_termination(void) {
+	Position *positions = malloc(BENCH_BATCH*sizeof(Position));
+	random_positions(positions, BENCH_BATCH);
+
+	double start = now();
+	size_t with_moves = 0;
+	for (size_t i = 0; i < BENCH_BATCH; ++i) {
+		Move_List list;
+		generate_legal(&positions[i], &list);
+		with_moves += list.len > 0;
+	}
+	report("termination/generate", BENCH_BATCH, now() - start, "positions");
+
+	start = now();
+	size_t with_moves_early = 0;
+	for (size_t i = 0; i < BENCH_BATCH; ++i) with_moves_early += position_has_legal_move(&positions[i]);
+	report("termination/early-exit", BENCH_BATCH, now() - start, "positions");
+
+	start = now();
+	size_t over = 0;
+	for (size_t i = 0; i < BENCH_BATCH; ++i) over += position_termination(&positions[i], NULL) != TERMINATION_NONE;
+	report("termination/classify", BENCH_BATCH, now() - start, "positions");
+	if (with_moves != with_moves_early) printf("termination: %zu positions with moves, expected %zu\n", with_moves_early, with_moves);
+	printf("termination: %zu of %zu positions are over\n", over, (size_t)BENCH_BATCH);
+
+	free(positions);
+}
+
+static const char *search_fens[] = {
+	"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+	"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+	"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+	"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+};
+#define SEARCH_FENS_LEN (sizeof(search_fens)/sizeof(search_fens[0]))
+
+// Searches every fen to depth, each from an empty table, adding up the time and nodes taken
+static void search_fens_to_depth(int depth, int threads, const Search_Options *options, double *seconds, uint64_t *nodes) {
+	*seconds = 0;
+	*nodes = 0;
+	for (size_t i = 0; i < SEARCH_FENS_LEN; ++i) {
+		Position position;
+		position_from_fen(&position, search_fens[i]);
+		Search *search = malloc(sizeof(Search));
+		search_init(search, BENCH_SEARCH_HASH_MB, threads);
+		if (options) search_set_options(search, options);
+		Search_Result result = search_run(search, &position, NULL, (Search_Limits){.depth = depth});
+		*seconds += result.seconds;
+		*nodes += result.nodes;
+		search_free(search);
+		free(search);
+	}
+}
+
+// Time to depth of Lazy SMP against a single thread
+static void bench_smp(void) {
+	int thread_counts[] = {1, 2, 4, 8, 16, 32, 64};
+	int cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	double single_seconds = 0;
+	for (size_t t = 0; t < sizeof(thread_counts)/sizeof(thread_counts[0]) && thread_counts[t] <= cpus; ++t) {
+		double seconds;
+		uint64_t nodes;
+		search_fens_to_depth(BENCH_SEARCH_DEPTH, thread_counts[t], NULL, &seconds, &nodes);
+		if (t == 0) single_seconds = seconds;
+		char name[32];
+		snprintf(name, sizeof(name), "smp/threads-%d", thread_counts[t]);
+		report(name, nodes, seconds, "nodes");
+		printf("%-24s depth %d in %6.3fs, %5.2fx the speed of one thread\n", name, BENCH_SEARCH_DEPTH, seconds, single_seconds/seconds);
+	}
+}
+
+/*
+	Time to depth of a single thread with every selective technique on, and with each one switched
+	off on its own. With all of them off the same depth takes minutes rather than seconds. A
+	technique that gets the search to its depth sooner is still only worth keeping if it plays
+	better in the same time, which this does not measure.
+*/
+static void bench_pruning(void) {
+	static const char *switches[] = {"null_move", "lmr", "reverse_futility", "futility", "late_move_pruning"};
+	int switches_len = sizeof(switches)/sizeof(switches[0]);
+	double all_seconds = 0;
+	for (int s = -1; s < switches_len; ++s) {
+		Search_Options options;
+		search_options_default(&options);
+		char name[48] = "pruning/all";
+		if (s >= 0) {
+			search_option_parse(&options, switches[s], "off");
+			snprintf(name, sizeof(name), "pruning/no-%s", switches[s]);
+		}
+		double seconds;
+		uint64_t nodes;
+		search_fens_to_depth(BENCH_PRUNING_DEPTH, 1, &options, &seconds, &nodes);
+		if (s == -1) all_seconds = seconds;
+		printf("%-30s depth %d in %7.3fs with %11llu nodes, %5.2fx the time with all of it\n", name, BENCH_PRUNING_DEPTH,
+			seconds, (unsigned long long)nodes, seconds/all_seconds);
+	}
+}
+
+typedef struct {
+	const char *name;
+	void (*run)(void);
+} Benchmark;
+
+static const Benchmark benchmarks[] = {
+	{"attacks", bench_attacks},
+	{"fill", bench_fill},
+	{"batch", bench_batch},
+	{"termination", bench_termination},
+	{"smp", bench_smp},
+	{"pruning", bench_pruning},
+};
+#define BENCHMARKS_LEN (sizeof(benchmarks)/sizeof(benchmarks[0]))
+
+int main(int argc, char **argv) {
+	attacks_init();
+	zobrist_init();
+	termination_init();
+	numa_init(true);
+	for (size_t i = 0; i < BENCHMARKS_LEN; ++i) {
+		bool selected = argc < 2;
+		for (int arg = 1; arg < argc; ++arg) selected |= strcmp(argv[arg], benchmarks[i].name) == 0;
+		if (selected) benchmarks[i].run();
+	}
+	return 0;
+}
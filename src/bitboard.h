@@ -0,0 +1,118 @@
+#ifndef BITBOARD_H_
+#define BITBOARD_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// The geometry is fixed at compile time, e.g. -DCOLS=10 -DROWS=10 for Grand chess
+#ifndef COLS
+#define COLS 8
+#endif
+#ifndef ROWS
+#define ROWS 8
+#endif
+#define BOARD_LEN (COLS*ROWS)
+
+#define MAX(a, b) ((a) > (b)?  (a): (b))
+
+/*
+	Squares are numbered the same way the board was always indexed: row*COLS+col, with row 0
+	being black's back rank (the top of the screen). Bit n of a bitboard is square n.
+
+	Boards up to 8x8 fit in a single 64-bit word. Anything larger up to 128 squares (10x10, 12x10)
+	uses the compiler's 128-bit integer, which keeps every operator working, so the rest of the
+	code is the same for both and the 8x8 build does not pay anything for the wider ones.
+*/
+#if BOARD_LEN <= 64
+typedef uint64_t Bitboard;
+#define BB_WIDE 0
+#else
+typedef unsigned __int128 Bitboard;
+#define BB_WIDE 1
+#endif
+#define BB_BITS (8*(int)sizeof(Bitboard))
+
+_Static_assert(BOARD_LEN <= 128, "Boards larger than 128 squares (such as 16x16) are not supported");
+
+typedef uint8_t Square;
+
+#define SQUARE_NONE 0xFF
+#define SQUARE(row, col) ((Square)((row)*COLS+(col)))
+#define SQUARE_ROW(sq) ((sq)/COLS)
+#define SQUARE_COL(sq) ((sq)%COLS)
+
+#define BB_EMPTY ((Bitboard)0)
+#define BB_ALL (~(Bitboard)0 >> (BB_BITS - BOARD_LEN))
+#define BB_SQUARE(sq) ((Bitboard)1 << (sq))
+#define BB_ROW_0 ((((Bitboard)1) << COLS) - 1)
+#define BB_COL_0 (BB_ALL / BB_ROW_0)
+#define BB_ROW(row) (BB_ROW_0 << ((row)*COLS))
+#define BB_COL(col) (BB_COL_0 << (col))
+
+#if BB_WIDE
+static inline int bb_count(Bitboard bb) {
+	return __builtin_popcountll((uint64_t)bb) + __builtin_popcountll((uint64_t)(bb >> 64));
+}
+
+static inline Square bb_first(Bitboard bb) {
+	uint64_t low = (uint64_t)bb;
+	return (Square)(low? __builtin_ctzll(low): 64 + __builtin_ctzll((uint64_t)(bb >> 64)));
+}
+
+static inline Square bb_last(Bitboard bb) {
+	uint64_t high = (uint64_t)(bb >> 64);
+	return (Square)(high? 127 - __builtin_clzll(high): 63 - __builtin_clzll((uint64_t)bb));
+}
+#else
+static inline int bb_count(Bitboard bb) {
+	return __builtin_popcountll(bb);
+}
+
+static inline Square bb_first(Bitboard bb) {
+	return (Square)__builtin_ctzll(bb);
+}
+
+static inline Square bb_last(Bitboard bb) {
+	return (Square)(63 - __builtin_clzll(bb));
+}
+#endif
+
+static inline Square bb_pop(Bitboard *bb) {
+	Square sq = bb_first(*bb);
+	*bb &= *bb - 1;
+	return sq;
+}
+
+static inline bool bb_has(Bitboard bb, Square sq) {
+	return (bb >> sq) & 1;
+}
+
+#define BB_FOREACH(sq, bb) for (Bitboard bb_iter_ = (bb); bb_iter_ && ((sq) = bb_pop(&bb_iter_), true);)
+
+// Columns that a shift by dx would wrap into, which have to be cleared after the shift
+static inline Bitboard bb_wrap_mask(int dx) {
+	if (dx > 0) return ~(BB_COL_0*((((Bitboard)1) << dx) - 1));
+	if (dx < 0) return ~(BB_COL_0*(((((Bitboard)1) << -dx) - 1) << (COLS+dx)));
+	return ~BB_EMPTY;
+}
+
+// Moves every square of bb by dx columns and dy rows, dropping anything that leaves the board
+static inline Bitboard bb_shift(Bitboard bb, int dx, int dy) {
+	int amount = dy*COLS + dx;
+	bb = amount > 0? bb << amount: bb >> -amount;
+	return bb & bb_wrap_mask(dx) & BB_ALL;
+}
+
+// Occluded fill: every square reachable from bb in direction (dx, dy) within distance steps, stopping on (and including) the first blocker
+static inline Bitboard bb_ray(Bitboard bb, int dx, int dy, Bitboard empty, uint8_t distance) {
+	Bitboard result = BB_EMPTY;
+	for (uint8_t i=0; i < distance && bb; ++i) {
+		bb = bb_shift(bb, dx, dy);
+		result |= bb;
+		bb &= empty;
+	}
+	return result;
+}
+
+#endif // BITBOARD_H_
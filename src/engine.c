@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "position.h"
+#include "attacks.h"
+#include "movegen.h"
+#include "zobrist.h"
+#include "termination.h"
+#include "search.h"
+#include "numa.h"
+
+#define ENGINE_HASH_MB 16
+
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+
+// One line of output for every line of the result, numbered when there is more than one to ask for
+static void print_line(const Search_Result *result, void *data) {
+	Search *search = data;
+	for (int i = 0; i < result->lines_len; ++i) {
+		const Search_Line *line = &result->lines[i];
+		char score[SCORE_NAME_LEN];
+		score_name(line->score, score);
+		printf("depth %2d ", result->depth);
+		if (search->limits.multipv > 1) printf("multipv %d ", i+1);
+		printf("score %-9s nodes %10llu nps %9.0f time %6.0f hashfull %4d pv", score, (unsigned long long)result->nodes,
+			result->nodes/result->seconds, result->seconds*1000, tt_hashfull(&search->tt));
+		for (int j = 0; j < line->pv_len; ++j) {
+			char name[10];
+			move_name(line->pv[j], name);
+			printf(" %s", name);
+		}
+		printf("\n");
+	}
+	fflush(stdout);
+}
+
+static void usage(const char *program) {
+	fprintf(stderr, "Usage: %s [options] [fen]  search the position and print the best move\n", program);
+	fprintf(stderr, "Options:\n");
+	fprintf(stderr, "       -depth <n>           stop after the iteration at depth n\n");
+	fprintf(stderr, "       -nodes <n>           stop after about n nodes\n");
+	fprintf(stderr, "       -time <ms>           stop after about ms milliseconds\n");
+	fprintf(stderr, "       -threads <n>         search with n threads sharing the table\n");
+	fprintf(stderr, "       -multipv <n>         print the best n moves with their lines, up to %d (default 1)\n", SEARCH_MAX_LINES);
+	fprintf(stderr, "       -hash <mb>           size of the transposition table (default %d)\n", ENGINE_HASH_MB);
+	fprintf(stderr, "       -numa <on|off>       pin threads to NUMA nodes and allocate their memory there (default on)\n");
+	fprintf(stderr, "       -interleave <on|off> spread the table over every NUMA node (default off)\n");
+	fprintf(stderr, "       -set <name=value>    set a search option, a switch takes on or off, the rest a number:");
+	for (int i = 0; search_option_name(i); ++i) fprintf(stderr, "%s%s", i % 5 == 0? "\n                            ": " ", search_option_name(i));
+	fprintf(stderr, "\n");
+}
+
+// Splits name=value and sets the option, false if there is no such option or the value does not fit it
+static bool set_option(Search_Options *options, const char *text) {
+	const char *equals = strchr(text, '=');
+	if (equals == NULL || equals - text >= 64) return false;
+	char name[64];
+	memcpy(name, text, equals - text);
+	name[equals - text] = '\0';
+	return search_option_parse(options, name, equals + 1);
+}
+
+int main(int argc, char **argv) {
+	int arg = 1;
+	Search_Limits limits = {0};
+	size_t hash_mb = ENGINE_HASH_MB;
+	int threads = 1;
+	bool is_numa = true;
+	bool is_interleaved = false;
+	bool is_valid = true;
+	Search_Options options;
+	search_options_default(&options);
+	for (; arg+1 < argc && argv[arg][0] == '-'; arg += 2) {
+		if (strcmp(argv[arg], "-depth") == 0) limits.depth = atoi(argv[arg+1]);
+		else if (strcmp(argv[arg], "-nodes") == 0) limits.nodes = strtoull(argv[arg+1], NULL, 10);
+		else if (strcmp(argv[arg], "-time") == 0) limits.time_ms = strtoll(argv[arg+1], NULL, 10);
+		else if (strcmp(argv[arg], "-threads") == 0) threads = atoi(argv[arg+1]);
+		else if (strcmp(argv[arg], "-multipv") == 0) limits.multipv = atoi(argv[arg+1]);
+		else if (strcmp(argv[arg], "-hash") == 0) hash_mb = strtoull(argv[arg+1], NULL, 10);
+		else if (strcmp(argv[arg], "-numa") == 0) is_numa = strcmp(argv[arg+1], "off") != 0;
+		else if (strcmp(argv[arg], "-interleave") == 0) is_interleaved = strcmp(argv[arg+1], "on") == 0;
+		else if (strcmp(argv[arg], "-set") == 0) is_valid &= set_option(&options, argv[arg+1]);
+		else break;
+	}
+	if (!is_valid || arg+1 < argc || (arg < argc && argv[arg][0] == '-') || limits.depth < 0 || limits.time_ms < 0 || limits.multipv < 0 || limits.multipv > SEARCH_MAX_LINES || threads < 1 || threads > SEARCH_MAX_THREADS) {
+		usage(argv[0]);
+		return 1;
+	}
+	// Without any limit the search would run until the last ply it can represent
+	if (limits.depth == 0 && limits.nodes == 0 && limits.time_ms == 0) limits.time_ms = 5000;
+	attacks_init();
+	zobrist_init();
+	termination_init();
+	numa_init(is_numa);
+
+	const char *fen = arg < argc? argv[arg]: START_FEN;
+	Position position;
+	if (!position_from_fen(&position, fen)) {
+		fprintf(stderr, "Invalid fen: %s\n", fen);
+		return 1;
+	}
+
+	static Search search;
+	search_init(&search, hash_mb, threads);
+	search_set_options(&search, &options);
+	search.report = print_line;
+	search.report_data = &search;
+	if (is_interleaved) numa_interleave(search.tt.buckets, tt_size(&search.tt));
+	static const char *pages_names[] = {[TT_PAGES_NORMAL] = "normal", [TT_PAGES_TRANSPARENT] = "transparent huge", [TT_PAGES_HUGE] = "huge"};
+	printf("hash %zu MB on %s pages%s, %d NUMA node%s\n", tt_size(&search.tt) >> 20, pages_names[search.tt.pages],
+		is_interleaved && numa_nodes() > 1? " interleaved": "", numa_nodes(), numa_nodes() == 1? "": "s");
+	Search_Result result = search_run(&search, &position, NULL, limits);
+
+	char name[10] = "none";
+	if (result.best_move != MOVE_NONE) move_name(result.best_move, name);
+	printf("bestmove %s\n", name);
+	search_free(&search);
+	return 0;
+}
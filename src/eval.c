@@ -0,0 +1,117 @@
+#include <stdlib.h>
+
+#include "eval.h"
+
+const int piece_values[TYPE_COUNT] = {
+	[TYPE_PAWN] = VALUE_PAWN, [TYPE_KNIGHT] = VALUE_KNIGHT, [TYPE_BISHOP] = VALUE_BISHOP,
+	[TYPE_ROOK] = VALUE_ROOK, [TYPE_QUEEN] = VALUE_QUEEN,
+};
+
+// Weight of each piece in the game phase, all of them together make up PHASE_MAX
+static const int phase_weights[TYPE_COUNT] = {
+	[TYPE_KNIGHT] = 1, [TYPE_BISHOP] = 1, [TYPE_ROOK] = 2, [TYPE_QUEEN] = 4,
+};
+#define PHASE_MAX 24
+
+#define BISHOP_PAIR 30
+#define PAWN_ISOLATED 10
+#define TEMPO 10
+
+typedef struct {
+	int middlegame;
+	int endgame;
+} Score;
+
+/*
+	There are no piece-square tables, since those only exist for 8x8. The positional terms are
+	worked out from how far a square is from the centre and how far a pawn has come instead,
+	which means the same for every board size.
+*/
+static int centre_distance(Square sq) {
+	// In half squares, so that boards with an even number of rows and columns still have a centre
+	return abs(2*SQUARE_COL(sq) - (COLS-1)) + abs(2*SQUARE_ROW(sq) - (ROWS-1));
+}
+
+// Rows a pawn of owner on sq has come from its starting row
+static int pawn_advance(Square sq, Piece_Owner owner) {
+	return owner == OWNER_WHITE? (ROWS-2) - SQUARE_ROW(sq): SQUARE_ROW(sq) - 1;
+}
+
+// The squares in front of a pawn, on its column and both neighbours, where an enemy pawn would stop it
+static Bitboard pawn_front_span(Square sq, Piece_Owner owner) {
+	Bitboard cols = BB_COL(SQUARE_COL(sq)) | bb_shift(BB_COL(SQUARE_COL(sq)), 1, 0) | bb_shift(BB_COL(SQUARE_COL(sq)), -1, 0);
+	Bitboard ahead = owner == OWNER_WHITE? BB_SQUARE(SQUARE(SQUARE_ROW(sq), 0)) - 1: BB_ALL & ~((BB_SQUARE(SQUARE(SQUARE_ROW(sq), 0)) << COLS) - 1);
+	return cols & ahead;
+}
+
+static Score evaluate_owner(const Position *position, Piece_Owner owner) {
+	Score score = {0, 0};
+	Bitboard ours = position->by_owner[owner];
+	Bitboard our_pawns = ours & position->by_type[TYPE_PAWN];
+	Bitboard their_pawns = position->by_owner[owner_next(owner)] & position->by_type[TYPE_PAWN];
+	Square sq;
+	BB_FOREACH(sq, ours) {
+		Piece_Type type = PIECE_PACKED_TYPE(position->mailbox[sq]);
+		int centre = centre_distance(sq);
+		score.middlegame += piece_values[type];
+		score.endgame += piece_values[type];
+		switch (type) {
+		case TYPE_NONE: break;
+		case TYPE_KNIGHT: {
+			score.middlegame -= 4*centre;
+			score.endgame -= 4*centre;
+			break;
+		}
+		case TYPE_BISHOP: {
+			score.middlegame -= 2*centre;
+			score.endgame -= 2*centre;
+			break;
+		}
+		case TYPE_ROOK: break;
+		case TYPE_QUEEN: {
+			score.middlegame -= centre;
+			score.endgame -= 2*centre;
+			break;
+		}
+		case TYPE_KING: {
+			// Sheltered on its own back row while there is material around, in the middle once it is gone
+			int back_row = owner == OWNER_WHITE? ROWS-1: 0;
+			score.middlegame -= 15*abs(SQUARE_ROW(sq) - back_row);
+			score.endgame -= 5*centre;
+			break;
+		}
+		case TYPE_PAWN: {
+			int advance = pawn_advance(sq, owner);
+			score.middlegame += 3*advance;
+			score.endgame += 2*advance*advance;
+			if (!(pawn_front_span(sq, owner) & their_pawns)) {
+				score.middlegame += 5*advance;
+				score.endgame += 4*advance*advance + 10;
+			}
+			Bitboard neighbours = bb_shift(BB_COL(SQUARE_COL(sq)), 1, 0) | bb_shift(BB_COL(SQUARE_COL(sq)), -1, 0);
+			if (!(neighbours & our_pawns)) {
+				score.middlegame -= PAWN_ISOLATED;
+				score.endgame -= PAWN_ISOLATED;
+			}
+			break;
+		}
+		}
+	}
+	if (bb_count(ours & position->by_type[TYPE_BISHOP]) >= 2) {
+		score.middlegame += BISHOP_PAIR;
+		score.endgame += BISHOP_PAIR;
+	}
+	return score;
+}
+
+int evaluate(const Position *position) {
+	Piece_Owner us = position->turn;
+	Score ours = evaluate_owner(position, us), theirs = evaluate_owner(position, owner_next(us));
+
+	int phase = 0;
+	for (Piece_Type type = TYPE_QUEEN; type <= TYPE_ROOK; ++type) phase += phase_weights[type]*bb_count(position->by_type[type]);
+	if (phase > PHASE_MAX) phase = PHASE_MAX;
+
+	int middlegame = ours.middlegame - theirs.middlegame, endgame = ours.endgame - theirs.endgame;
+	return (middlegame*phase + endgame*(PHASE_MAX - phase))/PHASE_MAX + TEMPO;
+}
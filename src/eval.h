@@ -0,0 +1,18 @@
+#ifndef EVAL_H_
+#define EVAL_H_
+
+#include "position.h"
+
+// In centipawns
+#define VALUE_PAWN 100
+#define VALUE_KNIGHT 320
+#define VALUE_BISHOP 330
+#define VALUE_ROOK 500
+#define VALUE_QUEEN 900
+
+extern const int piece_values[TYPE_COUNT];
+
+// From the point of view of position->turn
+int evaluate(const Position *position);
+
+#endif // EVAL_H_
@@ -0,0 +1,121 @@
+#include "fill.h"
+
+// Four 64-bit lanes to a register, boards that need wider bitboards always take the scalar path
+#if !BB_WIDE && defined(__x86_64__)
+#define FILL_AVX2 1
+#include <immintrin.h>
+#else
+#define FILL_AVX2 0
+#endif
+
+typedef struct {
+	int shift; // positive towards higher squares
+	Bitboard mask; // squares a one-step shift may land on without having wrapped around a row
+} Fill_Direction;
+
+#define FILL_DIRECTIONS 8
+
+// Rook directions first, then bishop directions, in the same rotation order as lines_attacks
+static void fill_directions(Fill_Direction *directions) {
+	int8_t starts[2][2] = {{1, 0}, {1, 1}};
+	for (int i = 0; i < 2; ++i) {
+		int8_t left = starts[i][0], up = starts[i][1];
+		int8_t dirs[4][2] = {{left, up}, {-up, left}, {-left, -up}, {up, -left}};
+		for (int j = 0; j < 4; ++j) {
+			int8_t dx = dirs[j][0], dy = dirs[j][1];
+			directions[4*i + j] = (Fill_Direction){dy*COLS + dx, bb_wrap_mask(dx) & BB_ALL};
+		}
+	}
+}
+
+// Doublings needed before a fill covers the longest ray
+static int fill_steps(void) {
+	int steps = 0;
+	while ((1 << steps) < MAX(COLS, ROWS)) ++steps;
+	return steps;
+}
+
+static inline Bitboard shift_by(Bitboard bb, int shift) {
+	return shift > 0? bb << shift: bb >> -shift;
+}
+
+static inline Bitboard fill_occluded(Bitboard gen, Bitboard empty, Fill_Direction direction, int steps) {
+	Bitboard pro = empty & direction.mask;
+	int shift = direction.shift;
+	for (int i = 0; i < steps; ++i, shift *= 2) {
+		gen |= pro & shift_by(gen, shift);
+		pro &= shift_by(pro, shift);
+	}
+	return shift_by(gen, direction.shift) & direction.mask;
+}
+
+static void fill_scalar_range(const Bitboard *rooks, const Bitboard *bishops, const Bitboard *occupied, Bitboard *attacks, size_t start, size_t end) {
+	Fill_Direction directions[FILL_DIRECTIONS];
+	fill_directions(directions);
+	int steps = fill_steps();
+	for (size_t i = start; i < end; ++i) {
+		Bitboard empty = ~occupied[i] & BB_ALL;
+		Bitboard result = BB_EMPTY;
+		for (int d = 0; d < FILL_DIRECTIONS; ++d) result |= fill_occluded(d < 4? rooks[i]: bishops[i], empty, directions[d], steps);
+		attacks[i] = result;
+	}
+}
+
+void fill_attacks_scalar(const Bitboard *rooks, const Bitboard *bishops, const Bitboard *occupied, Bitboard *attacks, size_t len) {
+	fill_scalar_range(rooks, bishops, occupied, attacks, 0, len);
+}
+
+#if FILL_AVX2
+__attribute__((target("avx2")))
+static inline __m256i shift_by_x4(__m256i bb, int shift) {
+	return shift > 0? _mm256_sll_epi64(bb, _mm_cvtsi32_si128(shift)): _mm256_srl_epi64(bb, _mm_cvtsi32_si128(-shift));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i fill_occluded_x4(__m256i gen, __m256i empty, Fill_Direction direction, int steps) {
+	__m256i mask = _mm256_set1_epi64x((long long)direction.mask);
+	__m256i pro = _mm256_and_si256(empty, mask);
+	int shift = direction.shift;
+	for (int i = 0; i < steps; ++i, shift *= 2) {
+		gen = _mm256_or_si256(gen, _mm256_and_si256(pro, shift_by_x4(gen, shift)));
+		pro = _mm256_and_si256(pro, shift_by_x4(pro, shift));
+	}
+	return _mm256_and_si256(shift_by_x4(gen, direction.shift), mask);
+}
+
+__attribute__((target("avx2")))
+static void fill_attacks_avx2(const Bitboard *rooks, const Bitboard *bishops, const Bitboard *occupied, Bitboard *attacks, size_t len) {
+	Fill_Direction directions[FILL_DIRECTIONS];
+	fill_directions(directions);
+	int steps = fill_steps();
+	__m256i all = _mm256_set1_epi64x((long long)BB_ALL);
+	size_t i = 0;
+	for (; i + 4 <= len; i += 4) {
+		__m256i rook_x4 = _mm256_loadu_si256((const __m256i *)(rooks + i));
+		__m256i bishop_x4 = _mm256_loadu_si256((const __m256i *)(bishops + i));
+		__m256i empty = _mm256_andnot_si256(_mm256_loadu_si256((const __m256i *)(occupied + i)), all);
+		__m256i result = _mm256_setzero_si256();
+		for (int d = 0; d < FILL_DIRECTIONS; ++d) result = _mm256_or_si256(result, fill_occluded_x4(d < 4? rook_x4: bishop_x4, empty, directions[d], steps));
+		_mm256_storeu_si256((__m256i *)(attacks + i), result);
+	}
+	fill_scalar_range(rooks, bishops, occupied, attacks, i, len);
+}
+#endif
+
+bool fill_has_avx2(void) {
+#if FILL_AVX2
+	return __builtin_cpu_supports("avx2");
+#else
+	return false;
+#endif
+}
+
+void fill_attacks(const Bitboard *rooks, const Bitboard *bishops, const Bitboard *occupied, Bitboard *attacks, size_t len) {
+#if FILL_AVX2
+	if (fill_has_avx2()) {
+		fill_attacks_avx2(rooks, bishops, occupied, attacks, len);
+		return;
+	}
+#endif
+	fill_attacks_scalar(rooks, bishops, occupied, attacks, len);
+}
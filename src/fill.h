@@ -0,0 +1,21 @@
+#ifndef FILL_H_
+#define FILL_H_
+
+#include "position.h"
+
+/*
+	Set-wise sliding attacks by Kogge-Stone occluded fill. Rather than looking up one piece at a
+	time, all the sliders of a position are pushed along a direction together, doubling the
+	distance covered with every step. Nothing is read from a table, so this keeps its speed on
+	batches of positions far larger than the cache, and with AVX2 four positions share each step.
+	The directions are the (1,0) and (1,1) rotations that lines_attacks walks one square at a time.
+*/
+
+// attacks[i] is every square attacked by the rook movers in rooks[i] and the bishop movers in bishops[i] (queens go in both)
+void fill_attacks(const Bitboard *rooks, const Bitboard *bishops, const Bitboard *occupied, Bitboard *attacks, size_t len);
+// The same, without ever using AVX2
+void fill_attacks_scalar(const Bitboard *rooks, const Bitboard *bishops, const Bitboard *occupied, Bitboard *attacks, size_t len);
+// Whether fill_attacks runs the AVX2 kernel on this machine
+bool fill_has_avx2(void);
+
+#endif // FILL_H_
@@ -3,14 +3,22 @@
 #include <string.h>
 #include <assert.h>
 #include <stdint.h>
+#include <unistd.h>
+
+#include "position.h"
+#include "attacks.h"
+#include "zobrist.h"
+#include "repetition.h"
+#include "termination.h"
+#include "movegen.h"
+#include "search.h"
+#include "thinker.h"
+#include "numa.h"
 
 #define CELL_WIDTH 80
 #define CELL_HEIGHT 80
-#define COLS 8
-#define ROWS 8
 #define SCREEN_WIDTH COLS*CELL_WIDTH
 #define SCREEN_HEIGHT ROWS*CELL_HEIGHT
-#define BOARD_LEN COLS*ROWS
 
 #define COLOUR_BACKGROUND GetColor(0x151515FF)
 #define COLOUR_BOARD_WHITE GetColor(0xF2E1C3FF)
@@ -21,66 +29,12 @@
 #define SPRITE_COLS 6
 #define SPRITE_ROWS 2
 
-Texture sprites_texture;
-
-typedef struct {
-	uint8_t x;
-	uint8_t y;
-} Pos;
-
-bool pos_eq(Pos a, Pos b) {
-	return a.x == b.x && a.y == b.y;
-}
-
-// Pieces
-
-// should be in the same order as the sprite map (left to right)
-typedef enum {
-	TYPE_NONE,
-	TYPE_KING,
-	TYPE_QUEEN,
-	TYPE_BISHOP,
-	TYPE_KNIGHT,
-	TYPE_ROOK,
-	TYPE_PAWN
-} Piece_Type;
-
-// should be in the same order as the sprite map (top to bottom)
-// OWNER_NONE should always be first
-typedef enum {
-	OWNER_NONE,
-	OWNER_WHITE,
-	OWNER_BLACK
-} Piece_Owner;
-
-Piece_Owner owner_next(Piece_Owner owner) {
-	switch (owner) {
-	case OWNER_NONE: return OWNER_NONE; // degenerate case
-	case OWNER_WHITE: return OWNER_BLACK;
-	case OWNER_BLACK: return OWNER_WHITE;
-	}
-}
-
-int owner_direction(Piece_Owner owner) {
-	switch (owner) {
-	case OWNER_NONE: return 0;
-	case OWNER_WHITE: return -1;
-	case OWNER_BLACK: return 1;
-	}
-}
-
-bool owner_is_pawn_promotable(Piece_Owner owner, Pos pos) {
-	switch (owner) {
-	case OWNER_NONE: return false;
-	case OWNER_WHITE: return pos.y == 0;
-	case OWNER_BLACK: return pos.y == ROWS-1;
-	}
-}
+#define COMPUTER_TIME_MS 1000
+#define COMPUTER_HASH_MB 64
+#define ANALYSIS_LINES 4
+#define ANALYSIS_SHOWN_PLIES 8 // of each line, along the bottom of the board
 
-typedef struct {
-	Piece_Type type;
-	Piece_Owner owner;
-} Piece;
+Texture sprites_texture;
 
 // Board
 
@@ -89,46 +43,24 @@ typedef struct {
 typedef enum {
 	STATE_PREMOVE, // Selected a piece -> STATE_SELECTED
 	STATE_SELECTED, // Cancel selection -> STATE_PREMOVE, Select a target -> STATE_PREMOVE, having moved piece (unless promoting)
-	STATE_PROMOTION
+	STATE_PROMOTION, // Pick a piece -> STATE_PREMOVE, having promoted, Click elsewhere -> STATE_PREMOVE
+	STATE_GAME_OVER // Take back -> STATE_PREMOVE
 } State_Kind;
 
-typedef enum {
-	SELECT_KIND_NONE = 0,
-	SELECT_KIND_DEFAULT,
-	SELECT_KIND_CASTLING,
-	SELECT_KIND_PROMOTION,
-	SELECT_KIND_DOUBLE_MOVE,
-	SELECT_KIND_EN_PASSANT
-} Selection_Kind;
-
-typedef struct {
-	uint8_t curr_col;
-	int dir;
-} Selection_Castling_Data;
-typedef struct {
-	Pos target;
-	Pos pawn;
-} DoubleMove_Data;
-
-typedef struct {
-	Selection_Kind kind;
-	union {
-		Selection_Castling_Data castling;
-		DoubleMove_Data double_move;
-	} data;
-} Selection;
-
 typedef struct {} Premove_Data;
 typedef struct {
 	Pos origin;
 	Piece piece;
-	Selection selections[BOARD_LEN];
+	Move_List moves; // only the moves of the selected piece
 } Selected_Data;
 typedef struct {
 	Pos pawn_pos;
+	Move move; // promotes to a queen, the other pieces are picked by changing the flag
 } Promotion_Data;
+typedef struct {
+	const char *reason;
+} Game_Over_Data;
 
-#define SELECTION_AT(row, col) (game.state.data.selected.selections[(row)*COLS+(col)])
 #define SWITCH_STATE(state, kind_) do { 			\
 	(state).kind = kind_; 							\
 	memset(&(state).data, 0, sizeof((state).data));	\
@@ -140,55 +72,41 @@ typedef struct {
 		Premove_Data premove;
 		Selected_Data selected;
 		Promotion_Data promotion;
+		Game_Over_Data game_over;
 	} data;
 } State;
 
 
+#define GAME_MAX_PLIES 2048
+
 typedef struct {
 	State state;
-	Piece board[BOARD_LEN];
-	bool has_moved[BOARD_LEN];
-	Piece_Owner turn;
-	bool was_previous_move_double_move;
-	DoubleMove_Data double_move;
+	Position position;
+	// Every move made so far and what it takes to undo it, for taking moves back
+	Move history[GAME_MAX_PLIES];
+	Undo undos[GAME_MAX_PLIES];
+	int plies;
+	Key_History keys; // one more than plies, starting with the initial position
+	Piece_Owner computer; // the side the computer replies for, OWNER_NONE to only move on request
+	bool is_thinking; // the computer is searching, on a thread of its own, for the move to play
+	uint32_t thinking_id; // of that search, results of any earlier one are not for this position
+	bool is_pondering; // the computer is searching on the player's time, on the reply it expects
+	Move ponder_move; // that reply
+	uint32_t ponder_id;
+	bool is_analysing; // the best lines for the position on the board are shown, whenever the computer is not busy
+	uint32_t analysis_id;
+	uint64_t analysis_key; // of the position being analysed
+	Thinker_Snapshot snapshot; // the latest the search has to show, kept when a frame cannot read a newer one
 } Game;
 Game game;
+Thinker thinker;
 
-#define BOARD_AT(row, col) (game.board[(row)*COLS+(col)])
-#define HAS_MOVED_AT(row, col) (game.has_moved[(row)*COLS+(col)])
-
-void set_piece(int row, int col, Piece_Type type, Piece_Owner owner) {
-	BOARD_AT(row, col).type = type;
-	BOARD_AT(row, col).owner = owner;
-}
-
-void reset_start_and_end_row(int row, Piece_Owner owner, uint8_t left_idx) {
-	set_piece(row, left_idx+0, TYPE_ROOK, owner);
-	set_piece(row, left_idx+1, TYPE_KNIGHT, owner);
-	set_piece(row, left_idx+2, TYPE_BISHOP, owner);
-	set_piece(row, left_idx+3, TYPE_QUEEN, owner);
-	set_piece(row, left_idx+4, TYPE_KING, owner);
-	set_piece(row, left_idx+5, TYPE_BISHOP, owner);
-	set_piece(row, left_idx+6, TYPE_KNIGHT, owner);
-	set_piece(row, left_idx+7, TYPE_ROOK, owner);
-}
-
-void reset_pawn_row(int row, Piece_Owner owner, uint8_t left_idx) {
-	for (int col = 0; col < 8; ++col) set_piece(row, col+left_idx, TYPE_PAWN, owner);
-}
+#define BOARD_AT(row, col) (position_at(&game.position, SQUARE(row, col)))
 
 void reset_game() {
 	memset(&game, 0, sizeof(game));
-
-	assert(COLS >= 8);
-	uint8_t left_idx = (COLS-8)>>1;
-
-	reset_start_and_end_row(0, OWNER_BLACK, left_idx);
-	reset_pawn_row(1, OWNER_BLACK, left_idx);
-	reset_pawn_row(ROWS-2, OWNER_WHITE, left_idx);
-	reset_start_and_end_row(ROWS-1, OWNER_WHITE, left_idx);
-
-	game.turn = OWNER_WHITE;
+	position_reset(&game.position);
+	key_history_push(&game.keys, game.position.key);
 }
 
 bool is_hovered(float x, float y, float w, float h) {
@@ -196,10 +114,6 @@ bool is_hovered(float x, float y, float w, float h) {
 	return pos.x >= x && pos.x <= x+w && pos.y >= y && pos.y <= y+h;
 }
 
-bool piece_is_empty(Piece piece) {
-	return piece.owner == OWNER_NONE || piece.type == TYPE_NONE;
-}
-
 void draw_piece(Piece piece, float x, float y) {
 	if (piece.owner == OWNER_NONE || piece.type == TYPE_NONE) return;
 
@@ -232,144 +146,190 @@ Pos get_mouse_pos(Vector2 mouse_position) {
 	return CLITERAL(Pos){(uint8_t)(mouse_position.x/CELL_WIDTH), (uint8_t)(mouse_position.y/CELL_HEIGHT)};
 }
 
-#define MOVEMENT(name) void movement_##name(Piece_Owner colour, uint8_t col, uint8_t row)
-#define MOVEMENT_BY(name) void movement_##name(Piece_Owner colour, uint8_t col, uint8_t row, uint8_t distance)
-#define MOVEMENT_WITH(name, ...) void movement_##name(Piece_Owner colour, uint8_t col, uint8_t row, uint8_t distance, __VA_ARGS__)
-
-#define MAX(a, b) ((a) > (b)?  (a): (b))
-
-bool is_valid_target(Piece_Owner colour, int8_t target_x, int8_t target_y) {
-	if (!(0 <= target_x && target_x < COLS && 0 <= target_y && target_y < ROWS)) return false;
-	return piece_is_empty(BOARD_AT(target_y, target_x)) || BOARD_AT(target_y, target_x).owner != colour;
+// The first of the selected piece's moves that lands on sq, for a promotion that is the one to a queen
+Move selected_move_to(Square sq) {
+	Move_List *moves = &game.state.data.selected.moves;
+	for (int i = 0; i < moves->len; ++i) {
+		if (move_to(moves->moves[i]) == sq) return moves->moves[i];
+	}
+	return MOVE_NONE;
 }
 
-MOVEMENT_WITH(line, int8_t left, int8_t up) {
-	for (uint8_t i=1; i <= distance; ++i) {
-		int8_t target_x = col+i*left, target_y = row+i*up;
-		if (!is_valid_target(colour, target_x, target_y)) break;
-		SWITCH_STATE(SELECTION_AT(target_y, target_x), SELECT_KIND_DEFAULT);
-		if (!piece_is_empty(BOARD_AT(target_y, target_x))) break;
-	}
+// The pieces to choose from are stacked from the promotion square towards the middle of the board
+Rectangle promotion_rect(Pos pawn_pos, Piece_Type type) {
+	int dir = pawn_pos.y == 0? 1: -1;
+	return cell_rect(pawn_pos.x, pawn_pos.y + dir*(type - TYPE_QUEEN));
 }
 
-MOVEMENT_WITH(lines, uint8_t left, uint8_t up) {
-	movement_line(colour, col, row, distance, left, up);
-	movement_line(colour, col, row, distance, -up, left);
-	movement_line(colour, col, row, distance, -left, -up);
-	movement_line(colour, col, row, distance, up, -left);
+void make_move(Move move) {
+	assert(game.plies < GAME_MAX_PLIES);
+	game.undos[game.plies] = position_make_move(&game.position, move);
+	game.history[game.plies++] = move;
+	key_history_push(&game.keys, game.position.key);
 }
 
-Selection_Kind pawn_selection(Piece_Owner colour, Pos target) {
-	return owner_is_pawn_promotable(colour, target)? SELECT_KIND_PROMOTION: SELECT_KIND_DEFAULT;
+void take_back() {
+	if (game.plies == 0) return;
+	--game.plies;
+	key_history_pop(&game.keys);
+	position_unmake_move(&game.position, game.history[game.plies], game.undos[game.plies]);
 }
 
-MOVEMENT(pawn) {
-	int dy = owner_direction(colour);
-	for (int dx=-1; dx<=1; dx+=2) { // just does -1,1
-		int8_t target_x = col+dx, target_y = row+dy;
-		if (!is_valid_target(colour, target_x, target_y)) continue;
-		Pos target = CLITERAL(Pos){target_x, target_y};
-
-		if (!piece_is_empty(BOARD_AT(target_y, target_x))) {
-			SWITCH_STATE(SELECTION_AT(target_y, target_x), pawn_selection(colour, target));
-		} else if (game.was_previous_move_double_move && pos_eq(game.double_move.target, target)){
-			SWITCH_STATE(SELECTION_AT(target_y, target_x), SELECT_KIND_EN_PASSANT);
-		}
+const char *termination_reason(Termination termination) {
+	switch (termination) {
+	case TERMINATION_NONE:                  return NULL;
+	case TERMINATION_CHECKMATE:             return game.position.turn == OWNER_WHITE? "Black wins by checkmate": "White wins by checkmate";
+	case TERMINATION_STALEMATE:             return "Draw by stalemate";
+	case TERMINATION_INSUFFICIENT_MATERIAL: return "Draw by insufficient material";
+	case TERMINATION_FIFTY_MOVES:           return "Draw by the fifty-move rule";
+	case TERMINATION_REPETITION:            return "Draw by threefold repetition";
 	}
+	assert(false && "Unreachable");
+}
 
-	int8_t target_x = col, target_y = row+dy;
-	if (!(is_valid_target(colour, target_x, target_y) && piece_is_empty(BOARD_AT(target_y, target_x)))) return;
-	Pos target = CLITERAL(Pos){target_x, target_y};
-
-	SWITCH_STATE(SELECTION_AT(target_y, target_x), pawn_selection(colour, target));
-
-	if (HAS_MOVED_AT(row, col)) return;
-	Pos single_move = target;
-
-	target_y = row+2*dy;
-	if (!(is_valid_target(colour, target_x, target_y) && piece_is_empty(BOARD_AT(target_y, target_x)))) return;
-	target.y = target_y;
-
-	SWITCH_STATE(SELECTION_AT(target_y, target_x), SELECT_KIND_DOUBLE_MOVE);
-	SELECTION_AT(target_y, target_x).data.double_move = CLITERAL(DoubleMove_Data){single_move, target};
+// Ends the game if the position just reached is decided
+void check_game_over() {
+	const char *reason = termination_reason(position_termination(&game.position, &game.keys));
+	if (reason == NULL) return;
+	SWITCH_STATE(game.state, STATE_GAME_OVER);
+	game.state.data.game_over.reason = reason;
 }
 
-MOVEMENT_BY(bishop) {
-	movement_lines(colour, col, row, distance, 1, 1);
+void computer_think() {
+	// The go supersedes any search there was, pondering and analysis included
+	game.is_pondering = false;
+	game.analysis_id = 0;
+	game.thinking_id = thinker_go(&thinker, &game.position, &game.keys, (Search_Limits){.time_ms = COMPUTER_TIME_MS});
+	game.is_thinking = game.thinking_id != 0;
 }
 
-MOVEMENT_BY(rook) {
-	movement_lines(colour, col, row, distance, 1, 0);
+// Searches the position after move, the reply the computer expects, for as long as the player thinks
+void computer_ponder(Move move) {
+	Move_List moves;
+	generate_legal(&game.position, &moves);
+	bool is_legal = false;
+	for (int i = 0; i < moves.len; ++i) is_legal |= moves.moves[i] == move;
+	if (!is_legal) return;
+	make_move(move);
+	game.analysis_id = 0;
+	game.ponder_id = thinker_go(&thinker, &game.position, &game.keys, (Search_Limits){.time_ms = COMPUTER_TIME_MS, .ponder = true});
+	take_back();
+	game.is_pondering = game.ponder_id != 0;
+	game.ponder_move = move;
 }
 
-MOVEMENT(knight) {
-	movement_lines(colour, col, row, 1, 2, 1);
-	movement_lines(colour, col, row, 1, 1, 2);
+/*
+	After the player's move: if it is the one pondered on, that search goes on as the computer's
+	real one, with everything it found so far. Otherwise it is stopped, and the next search still
+	starts out with the table it filled.
+*/
+void ponder_resolve(Move move) {
+	if (!game.is_pondering) return;
+	game.is_pondering = false;
+	if (move != game.ponder_move || game.state.kind != STATE_PREMOVE || game.computer != game.position.turn) {
+		thinker_stop(&thinker);
+		return;
+	}
+	thinker_ponderhit(&thinker, game.ponder_id);
+	game.is_thinking = true;
+	game.thinking_id = game.ponder_id;
 }
 
-MOVEMENT_BY(queen) {
-	movement_bishop(colour, col, row, distance);
-	movement_rook(colour, col, row, distance);
+// The player's move, from the board
+void player_move(Move move) {
+	make_move(move);
+	SWITCH_STATE(game.state, STATE_PREMOVE);
+	check_game_over();
+	ponder_resolve(move);
 }
 
-MOVEMENT(king) {
-	movement_queen(colour, col, row, 1);
-	if (HAS_MOVED_AT(row, col)) return;
-	for (int dir=-1; dir <= 1; dir+=2) {
-		for (int i=2; i<COLS; ++i) {
-			int8_t curr_col = col+dir*i;
-			if (!(0 <= curr_col && curr_col < COLS)) break;
-			Piece piece = BOARD_AT(row, curr_col);
-			if (piece_is_empty(piece)) continue;
-			if (piece.owner == colour && piece.type == TYPE_ROOK) {
-				SWITCH_STATE(SELECTION_AT(row, col+2*dir), SELECT_KIND_CASTLING);
-				SELECTION_AT(row, col+2*dir).data.castling = CLITERAL(Selection_Castling_Data){curr_col, dir};
-			}
-			break;
-		}
+// Plays the computer's move once its search is done, never waiting for it
+void computer_move() {
+	Thinker_Result result;
+	while (thinker_result(&thinker, &result)) {
+		if (!game.is_thinking || result.id != game.thinking_id) continue;
+		game.is_thinking = false;
+		if (result.result.best_move == MOVE_NONE) continue;
+		make_move(result.result.best_move);
+		check_game_over();
+		// The line the search found says what the player is likely to reply
+		if (game.computer != OWNER_NONE && game.state.kind == STATE_PREMOVE && result.result.pv_len >= 2) computer_ponder(result.result.pv[1]);
 	}
 }
 
-#define SELECTION(name) State selection_##name(uint8_t col, uint8_t row)
-#define SELECTION_WITH(name, ...) State selection_##name(uint8_t col, uint8_t row, __VA_ARGS__)
-
-SELECTION(default) {
-	game.was_previous_move_double_move = false;
-	memset(&game.double_move, 0, sizeof(game.double_move));
-	HAS_MOVED_AT(row, col) = true;
-	return CLITERAL(State){.kind = STATE_PREMOVE};
+// The key of the position on the board, which game.position.key is not while a piece is picked up
+uint64_t game_key() {
+	return key_history_last(&game.keys);
 }
 
-SELECTION(promotion) {
-	(void)col;
-	(void)row;
-	assert(false && "Unimplemented - promotion");
+// Keeps an analysis of the position on the board going, as long as the computer needs the engine for nothing else
+void analyse() {
+	if (!game.is_analysing || game.is_thinking || game.is_pondering) return;
+	if (game.state.kind == STATE_GAME_OVER && game.analysis_id != 0) {
+		thinker_stop(&thinker);
+		game.analysis_id = 0;
+	}
+	if (game.state.kind != STATE_PREMOVE || (game.analysis_id != 0 && game.analysis_key == game_key())) return;
+	game.analysis_key = game_key();
+	game.analysis_id = thinker_go(&thinker, &game.position, &game.keys, (Search_Limits){.multipv = ANALYSIS_LINES});
 }
 
-SELECTION_WITH(double_move, DoubleMove_Data data) {
-	State result = selection_default(col, row);
-	game.was_previous_move_double_move = true;
-	game.double_move = data;
-	return result;
+Vector2 square_centre(Square sq) {
+	Pos pos = square_pos(sq);
+	return CLITERAL(Vector2){pos.x*CELL_WIDTH + CELL_WIDTH/2, pos.y*CELL_HEIGHT + CELL_HEIGHT/2};
 }
 
-SELECTION(en_passant) {
-	assert(game.was_previous_move_double_move && "Unreachable");
-	Pos pawn = game.double_move.pawn;
-	State result = selection_default(col, row);
-	set_piece(pawn.y, pawn.x, TYPE_NONE, OWNER_NONE);
-	return result;
+// An arrow for the first move of each of the best lines, the best one boldest, and the lines themselves along the bottom
+void draw_analysis() {
+	if (!game.is_analysing || game.analysis_id == 0 || game.snapshot.id != game.analysis_id || game.analysis_key != game_key()) return;
+	int lines_len = game.snapshot.lines_len;
+	for (int i = lines_len - 1; i >= 0; --i) {
+		Move move = game.snapshot.lines[i].pv[0];
+		Color colour = Fade(BLUE, 0.8f - 0.15f*i);
+		DrawLineEx(square_centre(move_from(move)), square_centre(move_to(move)), 12 - 2*i, colour);
+		DrawCircleV(square_centre(move_to(move)), 14 - 2*i, colour);
+	}
+
+	int font_size = 20;
+	int y = SCREEN_HEIGHT - lines_len*font_size - 10;
+	DrawRectangle(0, y - 5, SCREEN_WIDTH, lines_len*font_size + 10, Fade(COLOUR_BACKGROUND, 0.8f));
+	for (int i = 0; i < lines_len; ++i) {
+		const Search_Line *line = &game.snapshot.lines[i];
+		char text[32 + ANALYSIS_SHOWN_PLIES*10], score[SCORE_NAME_LEN];
+		score_name(line->score, score);
+		int len = snprintf(text, sizeof(text), "%d. %-8s", i + 1, score);
+		for (int j = 0; j < line->pv_len && j < ANALYSIS_SHOWN_PLIES; ++j) {
+			char name[10];
+			move_name(line->pv[j], name);
+			len += snprintf(text + len, sizeof(text) - len, " %s", name);
+		}
+		DrawText(text, 10, y + i*font_size, font_size, RAYWHITE);
+	}
+	DrawText(TextFormat("depth %d", game.snapshot.depth), SCREEN_WIDTH - 100, y, font_size, RAYWHITE);
 }
 
-SELECTION_WITH(castling, Selection_Castling_Data data) {
-	selection_default(col-data.dir, row); // col is equal to col_origin+2*dir, and we want to calculate col_origin+dir
-	State result = selection_default(col, row);
-	BOARD_AT(row, col-data.dir) = BOARD_AT(row, data.curr_col);
-	set_piece(row, data.curr_col, TYPE_NONE, OWNER_NONE);
-	return result;
+void draw_thinking() {
+	const char *text = "Thinking...";
+	if (game.snapshot.id == game.thinking_id && game.snapshot.depth > 0) {
+		char score[SCORE_NAME_LEN], move[10];
+		score_name(game.snapshot.score, score);
+		move_name(game.snapshot.best_move, move);
+		text = TextFormat("Thinking... depth %d %s %s, %.1fM nodes", game.snapshot.depth, score, move, game.snapshot.nodes/1e6);
+	}
+	DrawText(text, 10, 10, 20, RED);
 }
 
 void draw_board() {
+	if (game.state.kind == STATE_PREMOVE && IsKeyPressed(KEY_C)) game.computer = game.computer == OWNER_NONE? owner_next(game.position.turn): OWNER_NONE;
+	if (game.state.kind == STATE_PREMOVE && !game.is_thinking && (IsKeyPressed(KEY_SPACE) || game.position.turn == game.computer)) computer_think();
+	if (IsKeyPressed(KEY_A)) {
+		game.is_analysing = !game.is_analysing;
+		if (game.analysis_id != 0) thinker_stop(&thinker);
+		game.analysis_id = 0;
+	}
+	analyse();
+	thinker_snapshot(&thinker, &game.snapshot);
+
 	for (int row = 0; row < ROWS; ++row) {
 		for (int col = 0; col < COLS; ++col) {
 			Color colour = (row + col) % 2 == 0 ? COLOUR_BOARD_WHITE : COLOUR_BOARD_BLACK;
@@ -390,11 +350,56 @@ void draw_board() {
 		draw_border(cell_rect(game.state.data.selected.origin.x, game.state.data.selected.origin.y), BLUE);
 		for (int row = 0; row < ROWS; ++row) {
 			for (int col = 0; col < COLS; ++col) {
-				if (SELECTION_AT(row, col).kind != SELECT_KIND_NONE) draw_border(cell_rect(col, row), GREEN);
+				if (selected_move_to(SQUARE(row, col)) != MOVE_NONE) draw_border(cell_rect(col, row), GREEN);
 			}
 		}
 	}
 
+	if (game.state.kind == STATE_PROMOTION) {
+		Pos pawn_pos = game.state.data.promotion.pawn_pos;
+		for (Piece_Type type = TYPE_QUEEN; type <= TYPE_ROOK; ++type) {
+			Rectangle rect = promotion_rect(pawn_pos, type);
+			DrawRectangleRec(rect, COLOUR_BACKGROUND);
+			draw_piece((Piece){type, game.position.turn}, rect.x+CELL_WIDTH/2, rect.y+CELL_HEIGHT/2);
+			if (is_hovered(rect.x, rect.y, rect.width, rect.height)) draw_border(rect, RED);
+		}
+		if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
+			Move move = game.state.data.promotion.move, promotion = MOVE_NONE;
+			for (Piece_Type type = TYPE_QUEEN; type <= TYPE_ROOK; ++type) {
+				Rectangle rect = promotion_rect(pawn_pos, type);
+				if (is_hovered(rect.x, rect.y, rect.width, rect.height)) promotion = move_make_promotion(move_from(move), move_to(move), type);
+			}
+			SWITCH_STATE(game.state, STATE_PREMOVE);
+			if (promotion != MOVE_NONE) player_move(promotion);
+		}
+	}
+
+	draw_analysis();
+
+	if (game.state.kind == STATE_GAME_OVER) {
+		const char *reason = game.state.data.game_over.reason;
+		int font_size = 40;
+		int width = MeasureText(reason, font_size);
+		DrawRectangle(0, SCREEN_HEIGHT/2 - font_size, SCREEN_WIDTH, 2*font_size, Fade(COLOUR_BACKGROUND, 0.8f));
+		DrawText(reason, (SCREEN_WIDTH - width)/2, SCREEN_HEIGHT/2 - font_size/2, font_size, RAYWHITE);
+	}
+
+	if (game.is_thinking) {
+		draw_thinking();
+		// Taking back while the computer thinks calls its search off as well
+		if (!IsKeyPressed(KEY_BACKSPACE)) return;
+		thinker_stop(&thinker);
+		game.is_thinking = false;
+	}
+
+	if ((game.state.kind == STATE_PREMOVE || game.state.kind == STATE_GAME_OVER) && IsKeyPressed(KEY_BACKSPACE)) {
+		ponder_resolve(MOVE_NONE);
+		take_back();
+		// Taking back the computer's reply as well gives the move back to the player
+		if (game.computer == game.position.turn) take_back();
+		SWITCH_STATE(game.state, STATE_PREMOVE);
+	}
+
 	if (game.state.kind == STATE_PREMOVE || game.state.kind == STATE_SELECTED) {
 		Vector2 mouse_position = GetMousePosition();
 		Pos curr_pos = get_mouse_pos(mouse_position);
@@ -404,40 +409,33 @@ void draw_board() {
 			uint8_t col = curr_pos.x, row = curr_pos.y;
 			if (game.state.kind == STATE_PREMOVE) {
 				Piece piece = BOARD_AT(row, col);
-				if (piece_is_empty(piece) || piece.owner != game.turn) return;
-				set_piece(row, col, TYPE_NONE, OWNER_NONE);
+				if (piece_is_empty(piece) || piece.owner != game.position.turn) return;
+				Move_List moves;
+				generate_legal(&game.position, &moves);
+				position_remove(&game.position, SQUARE(row, col));
 				SWITCH_STATE(game.state, STATE_SELECTED);
 				game.state.data.selected.origin = curr_pos;
 				game.state.data.selected.piece = piece;
-				// TODO: Check that these moves do not expose the king and check for any other rules that affect the legality of moves
-				switch (piece.type) {
-					case TYPE_NONE: assert(false && "Unreachable");
-					case TYPE_KING:   { movement_king(piece.owner, col, row);                    break;}
-					case TYPE_QUEEN:  { movement_queen(piece.owner, col, row, MAX(COLS, ROWS));  break;}
-					case TYPE_BISHOP: { movement_bishop(piece.owner, col, row, MAX(COLS, ROWS)); break;}
-					case TYPE_KNIGHT: { movement_knight(piece.owner, col, row);                  break;}
-					case TYPE_ROOK:   { movement_rook(piece.owner, col, row, MAX(COLS, ROWS));   break;}
-					case TYPE_PAWN:   { movement_pawn(piece.owner, col, row);                    break;}					
+				for (int i = 0; i < moves.len; ++i) {
+					if (move_from(moves.moves[i]) == SQUARE(row, col)) move_list_push(&game.state.data.selected.moves, moves.moves[i]);
 				}
 			} else if (game.state.kind == STATE_SELECTED) {
-				Selection selection = SELECTION_AT(row, col);
-				if (selection.kind == SELECT_KIND_NONE) {
+				Move move = selected_move_to(SQUARE(row, col));
+				if (move == MOVE_NONE) {
 					if (pos_eq(game.state.data.selected.origin, curr_pos)) {
-						BOARD_AT(row, col) = game.state.data.selected.piece;
+						position_put(&game.position, SQUARE(row, col), game.state.data.selected.piece);
 						SWITCH_STATE(game.state, STATE_PREMOVE);
 					}
 					return;
 				}
-				BOARD_AT(row, col) =  game.state.data.selected.piece;
-				switch (selection.kind) {
-					case SELECT_KIND_NONE: assert(false && "Unreachable");
-					case SELECT_KIND_DEFAULT:     { game.state = selection_default(col, row);                                 break; }
-					case SELECT_KIND_DOUBLE_MOVE: { game.state = selection_double_move(col, row, selection.data.double_move); break; }
-					case SELECT_KIND_EN_PASSANT:  { game.state = selection_en_passant(col, row);                              break; }
-					case SELECT_KIND_PROMOTION:   { game.state = selection_promotion(col, row);                               break; }
-					case SELECT_KIND_CASTLING:    { game.state = selection_castling(col, row, selection.data.castling);       break; }
+				position_put(&game.position, pos_square(game.state.data.selected.origin), game.state.data.selected.piece);
+				if (move_kind(move) == MOVE_PROMOTION) {
+					SWITCH_STATE(game.state, STATE_PROMOTION);
+					game.state.data.promotion.pawn_pos = curr_pos;
+					game.state.data.promotion.move = move;
+					return;
 				}
-				game.turn = owner_next(game.turn);
+				player_move(move);
 			} else {
 				assert(false && "Unreachable");
 			}
@@ -460,14 +458,24 @@ int main() {
 		SetTextureFilter(sprites_texture, TEXTURE_FILTER_BILINEAR);
 	}
 
+	attacks_init();
+	zobrist_init();
+	termination_init();
+	numa_init(true);
+	// One core is left for drawing, which never waits for the search
+	int threads = MAX(1, (int)sysconf(_SC_NPROCESSORS_ONLN) - 1);
+	if (threads > SEARCH_MAX_THREADS) threads = SEARCH_MAX_THREADS;
+	thinker_start(&thinker, COMPUTER_HASH_MB, threads);
 	reset_game();
 
 	while (!WindowShouldClose()) {
+		computer_move();
 		BeginDrawing();
 		ClearBackground(COLOUR_BACKGROUND);
 		draw_board();
 		EndDrawing();
 	}
 	CloseWindow();
+	thinker_quit(&thinker);
 	return 0;
 }
@@ -0,0 +1,306 @@
+#include <stdio.h>
+
+#include "movegen.h"
+#include "attacks.h"
+#include "zobrist.h"
+#include "attackmap.h"
+
+Bitboard position_attackers(const Position *position, Square sq, Bitboard occupied) {
+	Bitboard rooks = position->by_type[TYPE_ROOK] | position->by_type[TYPE_QUEEN];
+	Bitboard bishops = position->by_type[TYPE_BISHOP] | position->by_type[TYPE_QUEEN];
+	return (attacks_pawn(OWNER_WHITE, sq) & position_pieces(position, OWNER_BLACK, TYPE_PAWN))
+		| (attacks_pawn(OWNER_BLACK, sq) & position_pieces(position, OWNER_WHITE, TYPE_PAWN))
+		| (attacks_knight(sq) & position->by_type[TYPE_KNIGHT])
+		| (attacks_king(sq) & position->by_type[TYPE_KING])
+		| (attacks_rook(sq, occupied) & rooks)
+		| (attacks_bishop(sq, occupied) & bishops);
+}
+
+Bitboard position_attacked(const Position *position, Piece_Owner owner, Bitboard occupied) {
+	Bitboard pieces = position->by_owner[owner];
+	Bitboard attacked = pawn_attacks(pieces & position->by_type[TYPE_PAWN], owner);
+	Square sq;
+	BB_FOREACH(sq, pieces & position->by_type[TYPE_KNIGHT]) attacked |= attacks_knight(sq);
+	BB_FOREACH(sq, pieces & (position->by_type[TYPE_ROOK] | position->by_type[TYPE_QUEEN])) attacked |= attacks_rook(sq, occupied);
+	BB_FOREACH(sq, pieces & (position->by_type[TYPE_BISHOP] | position->by_type[TYPE_QUEEN])) attacked |= attacks_bishop(sq, occupied);
+	BB_FOREACH(sq, pieces & position->by_type[TYPE_KING]) attacked |= attacks_king(sq);
+	return attacked;
+}
+
+Bitboard position_checkers(const Position *position) {
+	Piece_Owner us = position->turn;
+	return position_attackers(position, position_king(position, us), position->occupied) & position->by_owner[owner_next(us)];
+}
+
+static Move *push_moves(Move *moves, Square from, Bitboard targets) {
+	Square to;
+	BB_FOREACH(to, targets) *moves++ = move_make(from, to, MOVE_NORMAL);
+	return moves;
+}
+
+static Move *push_pawn_moves(Move *moves, Square from, Bitboard targets, Piece_Owner us) {
+	Bitboard promotion_row = owner_promotion_row(us);
+	Square to;
+	BB_FOREACH(to, targets) {
+		if (bb_has(promotion_row, to)) {
+			for (Piece_Type type = TYPE_QUEEN; type <= TYPE_ROOK; ++type) *moves++ = move_make_promotion(from, to, type);
+		} else if (to == from+2*COLS || from == to+2*COLS) {
+			*moves++ = move_make(from, to, MOVE_DOUBLE_MOVE);
+		} else {
+			*moves++ = move_make(from, to, MOVE_NORMAL);
+		}
+	}
+	return moves;
+}
+
+// Only the squares the king could step or castle to, which is all the generator asks about
+static Bitboard mapped_danger(const Position *position, const Attack_Map *map, Square king, Bitboard checkers, Piece_Owner them) {
+	Bitboard theirs = position->by_owner[them];
+	Bitboard sliders = position->by_type[TYPE_ROOK] | position->by_type[TYPE_BISHOP] | position->by_type[TYPE_QUEEN];
+	Bitboard candidates = attacks_king(king) | bb_shift(BB_SQUARE(king), 2, 0) | bb_shift(BB_SQUARE(king), -2, 0);
+	Bitboard danger = BB_EMPTY;
+	Square sq;
+	BB_FOREACH(sq, candidates) {
+		if (map->attacks_to[sq] & theirs) danger |= BB_SQUARE(sq);
+	}
+	// The map stops a checking slider at the king, but stepping back along its line is no escape
+	BB_FOREACH(sq, checkers & sliders) danger |= squares_line(king, sq) & ~squares_between(king, sq) & ~BB_SQUARE(sq);
+	return danger;
+}
+
+/*
+	Checkers, pinned pieces and the squares the king may not step on are worked out once up front,
+	so every move that gets emitted is already legal and nothing has to be played out to test it.
+	Only pieces on origins are moved, which lets a single move be checked without generating the rest,
+	and with first_only it returns as soon as it has any move at all, for asking whether one exists.
+*/
+static Move *generate(const Position *position, const Attack_Map *map, Move *moves, Gen_Type type, Bitboard origins, bool first_only) {
+	Move *start = moves;
+	Piece_Owner us = position->turn, them = owner_next(us);
+	Bitboard ours = position->by_owner[us], theirs = position->by_owner[them];
+	Bitboard occupied = position->occupied;
+	Bitboard their_rooks = theirs & (position->by_type[TYPE_ROOK] | position->by_type[TYPE_QUEEN]);
+	Bitboard their_bishops = theirs & (position->by_type[TYPE_BISHOP] | position->by_type[TYPE_QUEEN]);
+	Square king = position_king(position, us);
+
+	Bitboard checkers = (map? attack_map_attackers(map, king): position_attackers(position, king, occupied)) & theirs;
+	// The king is taken off the board, otherwise it would hide the squares behind it from a checking slider
+	Bitboard danger = !bb_has(origins, king)? BB_EMPTY
+		: map? mapped_danger(position, map, king, checkers, them)
+		: position_attacked(position, them, occupied ^ BB_SQUARE(king));
+
+	// Captures come with promotions, as both change the material
+	Bitboard wanted = type == GEN_CAPTURES? theirs: type == GEN_QUIETS? ~occupied: ~ours;
+	if (bb_has(origins, king)) moves = push_moves(moves, king, attacks_king(king) & wanted & ~danger);
+	if (bb_count(checkers) > 1 || (first_only && moves != start)) return moves;
+
+	// Anything other than the king has to capture the checker or block it
+	Bitboard evasions = checkers? squares_between(king, bb_first(checkers)) | checkers: BB_ALL;
+	Bitboard targets = wanted & evasions;
+
+	Bitboard pinned = BB_EMPTY;
+	Bitboard snipers = (attacks_rook(king, theirs) & their_rooks) | (attacks_bishop(king, theirs) & their_bishops);
+	Square sq;
+	BB_FOREACH(sq, snipers) {
+		Bitboard blockers = squares_between(king, sq) & occupied;
+		if (bb_count(blockers) == 1) pinned |= blockers & ours;
+	}
+
+	Square from;
+	BB_FOREACH(from, ours & origins & ~position->by_type[TYPE_KING] & ~position->by_type[TYPE_PAWN]) {
+		Bitboard to = attacks_piece(position_at(position, from), from, occupied) & targets;
+		if (bb_has(pinned, from)) to &= squares_line(king, from);
+		moves = push_moves(moves, from, to);
+		if (first_only && moves != start) return moves;
+	}
+
+	Bitboard empty = ~occupied & BB_ALL;
+	Bitboard promotion_row = owner_promotion_row(us);
+	BB_FOREACH(from, position_pieces(position, us, TYPE_PAWN) & origins) {
+		Bitboard allowed = bb_has(pinned, from)? evasions & squares_line(king, from): evasions;
+		Bitboard captures = attacks_pawn(us, from) & theirs, pushes = pawn_pushes(BB_SQUARE(from), us, empty);
+		Bitboard to = type == GEN_CAPTURES? captures | (pushes & promotion_row)
+			: type == GEN_QUIETS? pushes & ~promotion_row
+			: captures | pushes;
+		moves = push_pawn_moves(moves, from, to & allowed, us);
+		if (first_only && moves != start) return moves;
+
+		Square ep = position->double_move;
+		if (type == GEN_QUIETS) continue;
+		if (ep == SQUARE_NONE || !bb_has(attacks_pawn(us, from), ep)) continue;
+		Square captured = SQUARE(SQUARE_ROW(from), SQUARE_COL(ep));
+		if (!(evasions & (BB_SQUARE(ep) | BB_SQUARE(captured)))) continue;
+		// Two pawns leave the row at once, so pins are checked on the resulting occupancy instead
+		Bitboard after = (occupied ^ BB_SQUARE(from) ^ BB_SQUARE(captured)) | BB_SQUARE(ep);
+		if (attacks_rook(king, after) & their_rooks & ~BB_SQUARE(captured)) continue;
+		if (attacks_bishop(king, after) & their_bishops & ~BB_SQUARE(captured)) continue;
+		*moves++ = move_make(from, ep, MOVE_EN_PASSANT);
+	}
+
+	if (!checkers && type != GEN_CAPTURES && bb_has(origins, king)) {
+		uint8_t rights = position->castling & CASTLE_OWNER(us);
+		for (int i = 0; i < 4; ++i) {
+			if (!(rights & (1 << i))) continue;
+			Square rook = position->castling_rooks[i];
+			if (!bb_has(position_pieces(position, us, TYPE_ROOK), rook)) continue;
+			if (squares_between(king, rook) & occupied) continue;
+			int dir = SQUARE_COL(rook) < SQUARE_COL(king)? -1: 1;
+			Square to = king + 2*dir;
+			if ((squares_between(king, to) | BB_SQUARE(to)) & danger) continue;
+			*moves++ = move_make(king, to, MOVE_CASTLING);
+		}
+	}
+
+	return moves;
+}
+
+void generate_moves(const Position *position, Move_List *list, Gen_Type type) {
+	list->len = generate(position, NULL, list->moves, type, BB_ALL, false) - list->moves;
+}
+
+void generate_legal(const Position *position, Move_List *list) {
+	generate_moves(position, list, GEN_ALL);
+}
+
+Move *generate_legal_into(const Position *position, Move *moves) {
+	return generate(position, NULL, moves, GEN_ALL, BB_ALL, false);
+}
+
+void generate_legal_mapped(const Position *position, const Attack_Map *map, Move_List *list) {
+	list->len = generate(position, map, list->moves, GEN_ALL, BB_ALL, false) - list->moves;
+}
+
+bool position_is_legal(const Position *position, Move move) {
+	Move moves[MAX_MOVES];
+	Move *end = generate(position, NULL, moves, GEN_ALL, BB_SQUARE(move_from(move)), false);
+	for (Move *it = moves; it < end; ++it) {
+		if (*it == move) return true;
+	}
+	return false;
+}
+
+bool position_has_legal_move(const Position *position) {
+	Move moves[MAX_MOVES];
+	return generate(position, NULL, moves, GEN_ALL, BB_ALL, true) != moves;
+}
+
+bool position_is_capture(const Position *position, Move move) {
+	Move_Kind kind = move_kind(move);
+	return kind == MOVE_EN_PASSANT || kind == MOVE_PROMOTION || position->mailbox[move_to(move)] != 0;
+}
+
+static inline Square castling_rook_target(Square from, Square to) {
+	return to > from? to-1: to+1;
+}
+
+Undo position_make_move(Position *position, Move move) {
+	Square from = move_from(move), to = move_to(move);
+	Undo undo = {position->mailbox[to], position->castling, position->double_move, position->halfmove};
+	Piece_Owner us = position->turn;
+
+	// Captures and pawn moves cannot be undone, so nothing before them can ever be repeated
+	bool irreversible = undo.captured || bb_has(position->by_type[TYPE_PAWN], from);
+	position->halfmove = irreversible? 0: position->halfmove + 1;
+
+	position->double_move = SQUARE_NONE;
+	switch (move_kind(move)) {
+	case MOVE_NORMAL: {
+		if (undo.captured) position_remove(position, to);
+		position_move(position, from, to);
+		break;
+	}
+	case MOVE_DOUBLE_MOVE: {
+		position_move(position, from, to);
+		position->double_move = (from + to)/2;
+		break;
+	}
+	case MOVE_EN_PASSANT: {
+		position_move(position, from, to);
+		position_remove(position, SQUARE(SQUARE_ROW(from), SQUARE_COL(to)));
+		break;
+	}
+	case MOVE_CASTLING: {
+		Square rook = position_castling_rook(position, from, to > from? 1: -1);
+		position_move(position, from, to);
+		position_move(position, rook, castling_rook_target(from, to));
+		break;
+	}
+	case MOVE_PROMOTION: {
+		if (undo.captured) position_remove(position, to);
+		position_remove(position, from);
+		position_put(position, to, (Piece){move_promotion(move), us});
+		break;
+	}
+	}
+
+	if (position->castling) position->castling &= ~(position_castling_lost(position, from) | position_castling_lost(position, to));
+	position->turn = owner_next(us);
+	// The pieces were hashed in and out as they moved, the rest is swapped here
+	position->key ^= zobrist_state(undo.castling, undo.double_move) ^ zobrist_state(position->castling, position->double_move) ^ zobrist_turn;
+	return undo;
+}
+
+/*
+	Nothing can be repeated across a null move, as the position after it could never come up in
+	a game, so the halfmove clock starts over as after an irreversible move.
+*/
+Undo position_make_null_move(Position *position) {
+	Undo undo = {0, position->castling, position->double_move, position->halfmove};
+	position->halfmove = 0;
+	position->double_move = SQUARE_NONE;
+	position->turn = owner_next(position->turn);
+	position->key ^= zobrist_state(undo.castling, undo.double_move) ^ zobrist_state(position->castling, position->double_move) ^ zobrist_turn;
+	return undo;
+}
+
+void position_unmake_null_move(Position *position, Undo undo) {
+	position->key ^= zobrist_state(position->castling, position->double_move) ^ zobrist_state(undo.castling, undo.double_move) ^ zobrist_turn;
+	position->turn = owner_next(position->turn);
+	position->double_move = undo.double_move;
+	position->halfmove = undo.halfmove;
+}
+
+void position_unmake_move(Position *position, Move move, Undo undo) {
+	Square from = move_from(move), to = move_to(move);
+	Piece_Owner us = owner_next(position->turn);
+	position->key ^= zobrist_state(position->castling, position->double_move) ^ zobrist_state(undo.castling, undo.double_move) ^ zobrist_turn;
+	position->turn = us;
+	position->castling = undo.castling;
+	position->double_move = undo.double_move;
+	position->halfmove = undo.halfmove;
+
+	switch (move_kind(move)) {
+	case MOVE_NORMAL:
+	case MOVE_DOUBLE_MOVE: {
+		position_move(position, to, from);
+		break;
+	}
+	case MOVE_EN_PASSANT: {
+		position_move(position, to, from);
+		position_put(position, SQUARE(SQUARE_ROW(from), SQUARE_COL(to)), (Piece){TYPE_PAWN, owner_next(us)});
+		break;
+	}
+	case MOVE_CASTLING: {
+		Square rook = position_castling_rook(position, from, to > from? 1: -1);
+		position_move(position, castling_rook_target(from, to), rook);
+		position_move(position, to, from);
+		break;
+	}
+	case MOVE_PROMOTION: {
+		position_remove(position, to);
+		position_put(position, from, (Piece){TYPE_PAWN, us});
+		break;
+	}
+	}
+
+	if (undo.captured) position_put(position, to, (Piece){PIECE_PACKED_TYPE(undo.captured), PIECE_PACKED_OWNER(undo.captured)});
+}
+
+void move_name(Move move, char *name) {
+	static const char promotions[TYPE_COUNT] = {[TYPE_QUEEN] = 'q', [TYPE_BISHOP] = 'b', [TYPE_KNIGHT] = 'n', [TYPE_ROOK] = 'r'};
+	char from[4], to[4];
+	square_name(move_from(move), from);
+	square_name(move_to(move), to);
+	if (move_kind(move) == MOVE_PROMOTION) snprintf(name, 10, "%s%s%c", from, to, promotions[move_promotion(move)]);
+	else snprintf(name, 10, "%s%s", from, to);
+}
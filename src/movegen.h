@@ -0,0 +1,117 @@
+#ifndef MOVEGEN_H_
+#define MOVEGEN_H_
+
+#include "position.h"
+
+#define MAX_MOVES 256
+
+typedef enum {
+	MOVE_NORMAL,
+	MOVE_DOUBLE_MOVE,
+	MOVE_CASTLING, // to is the square the king lands on
+	MOVE_EN_PASSANT,
+	MOVE_PROMOTION // and up, the flag carries the piece as well
+} Move_Kind;
+
+/*
+	A move is packed into 16 bits: from in the low bits, to above it, and the flag in the top 4.
+	The flag is the Move_Kind, except that promotions add the promoted piece on top of MOVE_PROMOTION,
+	so that the whole move still fits into a hash entry or a game record. Boards with more than
+	64 squares need 7 bits per square, which no longer leaves room for the flag in 16 bits.
+*/
+#if BB_WIDE
+typedef uint32_t Move;
+#define MOVE_SQUARE_BITS 7
+#else
+typedef uint16_t Move;
+#define MOVE_SQUARE_BITS 6
+#endif
+#define MOVE_SQUARE_MASK ((1 << MOVE_SQUARE_BITS) - 1)
+#define MOVE_FLAG_SHIFT (2*MOVE_SQUARE_BITS)
+#define MOVE_NONE 0 // from and to are the same square, which no move can have
+
+_Static_assert(BOARD_LEN <= (1 << MOVE_SQUARE_BITS), "Squares do not fit into a move");
+
+static inline Move move_make(Square from, Square to, Move_Kind kind) {
+	return from | to << MOVE_SQUARE_BITS | kind << MOVE_FLAG_SHIFT;
+}
+
+static inline Move move_make_promotion(Square from, Square to, Piece_Type type) {
+	return move_make(from, to, MOVE_PROMOTION + (type - TYPE_QUEEN));
+}
+
+static inline Square move_from(Move move) {
+	return move & MOVE_SQUARE_MASK;
+}
+
+static inline Square move_to(Move move) {
+	return move >> MOVE_SQUARE_BITS & MOVE_SQUARE_MASK;
+}
+
+static inline Move_Kind move_kind(Move move) {
+	unsigned flag = move >> MOVE_FLAG_SHIFT;
+	return flag >= MOVE_PROMOTION? MOVE_PROMOTION: flag;
+}
+
+// Only meaningful for MOVE_PROMOTION
+static inline Piece_Type move_promotion(Move move) {
+	return TYPE_QUEEN + ((move >> MOVE_FLAG_SHIFT) - MOVE_PROMOTION);
+}
+
+// Lives on the stack, so nothing is allocated while searching
+typedef struct {
+	Move moves[MAX_MOVES];
+	int len;
+} Move_List;
+
+static inline void move_list_push(Move_List *list, Move move) {
+	list->moves[list->len++] = move;
+}
+
+// Every piece of either owner that attacks sq, given the occupancy
+Bitboard position_attackers(const Position *position, Square sq, Bitboard occupied);
+// Every square attacked by the pieces of owner, given the occupancy
+Bitboard position_attacked(const Position *position, Piece_Owner owner, Bitboard occupied);
+Bitboard position_checkers(const Position *position);
+
+// Everything a move destroys that cannot be worked out from the move itself
+typedef struct {
+	uint8_t captured; // packed piece, 0 if nothing was captured on the target square
+	uint8_t castling;
+	Square double_move;
+	uint16_t halfmove;
+} Undo;
+
+// Plays a legal move on position, which then belongs to the other side
+Undo position_make_move(Position *position, Move move);
+// Takes back move, which has to be the last move made on position
+void position_unmake_move(Position *position, Move move, Undo undo);
+// Passes the turn, for null-move pruning. Not legal when in check.
+Undo position_make_null_move(Position *position);
+void position_unmake_null_move(Position *position, Undo undo);
+// Writes move in coordinate notation (e.g. "e7e8q") into name, which needs room for 10 characters
+void move_name(Move move, char *name);
+
+typedef enum {
+	GEN_ALL,
+	GEN_CAPTURES, // and promotions, which is what position_is_capture accepts
+	GEN_QUIETS // everything else
+} Gen_Type;
+
+// Fills list with the strictly legal moves of position->turn of the given type
+void generate_moves(const Position *position, Move_List *list, Gen_Type type);
+// Fills list with every strictly legal move of position->turn
+void generate_legal(const Position *position, Move_List *list);
+// The same, written to moves, which needs room for MAX_MOVES, returning the end of what was written
+Move *generate_legal_into(const Position *position, Move *moves);
+typedef struct Attack_Map Attack_Map;
+// The same, reading checks and attacked squares from map (see attackmap.h) instead of working them out
+void generate_legal_mapped(const Position *position, const Attack_Map *map, Move_List *list);
+// Whether move is one of the legal moves, for moves from elsewhere such as a hash table
+bool position_is_legal(const Position *position, Move move);
+// Stops at the first legal move it finds, the king's first as those are the cheapest
+bool position_has_legal_move(const Position *position);
+// Captures and promotions, the moves GEN_CAPTURES generates
+bool position_is_capture(const Position *position, Move move);
+
+#endif // MOVEGEN_H_
@@ -0,0 +1,123 @@
+#include <string.h>
+#include <assert.h>
+
+#include "movepick.h"
+
+// Only the order matters, the king never gets captured
+static const int mvv_lva_rank[TYPE_COUNT] = {
+	[TYPE_PAWN] = 1, [TYPE_KNIGHT] = 2, [TYPE_BISHOP] = 3, [TYPE_ROOK] = 4, [TYPE_QUEEN] = 5, [TYPE_KING] = 6
+};
+
+static int mvv_lva(const Position *position, Move move) {
+	Piece_Type victim = PIECE_PACKED_TYPE(position->mailbox[move_to(move)]);
+	if (move_kind(move) == MOVE_EN_PASSANT) victim = TYPE_PAWN;
+	int score = 8*mvv_lva_rank[victim] - mvv_lva_rank[PIECE_PACKED_TYPE(position->mailbox[move_from(move)])];
+	// A promotion gains the promoted piece in place of the pawn, as if it had been captured
+	if (move_kind(move) == MOVE_PROMOTION) score += 8*(mvv_lva_rank[move_promotion(move)] - mvv_lva_rank[TYPE_PAWN]);
+	return score;
+}
+
+static bool is_killer(const Move_Picker *picker, Move move) {
+	for (int i = 0; i < KILLERS_LEN + 1; ++i) {
+		if (picker->killers[i] == move) return true;
+	}
+	return false;
+}
+
+// Selection sort one step at a time, since most nodes only ever look at the first few moves
+static Move pick_best(Move_Picker *picker) {
+	int best = picker->index;
+	for (int i = best+1; i < picker->moves.len; ++i) {
+		if (picker->scores[i] > picker->scores[best]) best = i;
+	}
+	Move move = picker->moves.moves[best];
+	int score = picker->scores[best];
+	picker->moves.moves[best] = picker->moves.moves[picker->index];
+	picker->scores[best] = picker->scores[picker->index];
+	picker->moves.moves[picker->index] = move;
+	picker->scores[picker->index] = score;
+	++picker->index;
+	return move;
+}
+
+void move_picker_init(Move_Picker *picker, const Position *position, Move hash_move, const Move *killers) {
+	picker->position = position;
+	picker->stage = PICK_HASH;
+	picker->hash_move = hash_move;
+	memset(picker->killers, 0, sizeof(picker->killers));
+	if (killers) memcpy(picker->killers, killers, KILLERS_LEN*sizeof(Move));
+	picker->captures_only = false;
+	picker->ordering = NULL;
+	picker->node = NULL;
+	picker->moves.len = 0;
+	picker->index = 0;
+}
+
+void move_picker_use_ordering(Move_Picker *picker, const Ordering *ordering, const Ordering_Node *node) {
+	picker->ordering = ordering;
+	picker->node = node;
+	if (node->countermove) picker->killers[KILLERS_LEN] = *node->countermove;
+}
+
+void move_picker_init_captures(Move_Picker *picker, const Position *position) {
+	move_picker_init(picker, position, MOVE_NONE, NULL);
+	picker->captures_only = true;
+	picker->stage = PICK_CAPTURES_GENERATE;
+}
+
+Move move_picker_next(Move_Picker *picker) {
+	const Position *position = picker->position;
+	switch (picker->stage) {
+	case PICK_HASH: {
+		picker->stage = PICK_CAPTURES_GENERATE;
+		if (picker->hash_move != MOVE_NONE && position_is_legal(position, picker->hash_move)) return picker->hash_move;
+		picker->hash_move = MOVE_NONE;
+	} // fallthrough
+	case PICK_CAPTURES_GENERATE: {
+		generate_moves(position, &picker->moves, GEN_CAPTURES);
+		for (int i = 0; i < picker->moves.len; ++i) picker->scores[i] = mvv_lva(position, picker->moves.moves[i]);
+		picker->index = 0;
+		picker->stage = PICK_CAPTURES;
+	} // fallthrough
+	case PICK_CAPTURES: {
+		while (picker->index < picker->moves.len) {
+			Move move = pick_best(picker);
+			if (move != picker->hash_move) return move;
+		}
+		picker->index = 0;
+		picker->stage = picker->captures_only? PICK_DONE: PICK_KILLERS;
+		if (picker->captures_only) return MOVE_NONE;
+	} // fallthrough
+	case PICK_KILLERS: {
+		while (picker->index < KILLERS_LEN + 1) {
+			int i = picker->index++;
+			Move move = picker->killers[i];
+			if (move == MOVE_NONE || move == picker->hash_move) continue;
+			bool is_duplicate = false;
+			for (int j = 0; j < i; ++j) is_duplicate |= picker->killers[j] == move;
+			if (is_duplicate) continue;
+			// Killers come from sibling nodes, so here they may be captures or not even legal
+			if (position_is_capture(position, move) || !position_is_legal(position, move)) continue;
+			return move;
+		}
+		picker->stage = PICK_QUIETS_GENERATE;
+	} // fallthrough
+	case PICK_QUIETS_GENERATE: {
+		generate_moves(position, &picker->moves, GEN_QUIETS);
+		if (picker->ordering) {
+			for (int i = 0; i < picker->moves.len; ++i) picker->scores[i] = ordering_score(picker->ordering, picker->node, position, picker->moves.moves[i]);
+		}
+		picker->index = 0;
+		picker->stage = PICK_QUIETS;
+	} // fallthrough
+	case PICK_QUIETS: {
+		while (picker->index < picker->moves.len) {
+			Move move = picker->ordering? pick_best(picker): picker->moves.moves[picker->index++];
+			if (move != picker->hash_move && !is_killer(picker, move)) return move;
+		}
+		picker->stage = PICK_DONE;
+	} // fallthrough
+	case PICK_DONE: return MOVE_NONE;
+	}
+	assert(false && "Unreachable");
+}
@@ -0,0 +1,46 @@
+#ifndef MOVEPICK_H_
+#define MOVEPICK_H_
+
+#include "movegen.h"
+#include "ordering.h"
+
+typedef enum {
+	PICK_HASH,
+	PICK_CAPTURES_GENERATE,
+	PICK_CAPTURES,
+	PICK_KILLERS,
+	PICK_QUIETS_GENERATE,
+	PICK_QUIETS,
+	PICK_DONE
+} Pick_Stage;
+
+/*
+	Hands out the moves of a position one at a time: the hash move, then captures with the most
+	valuable victim and least valuable attacker first, then the killers and the countermove, then
+	the quiet moves, best history first when there is an Ordering to read it from.
+	A stage is only generated once the one before it has run out, so a node that is cut off by
+	the hash move or a capture never generates its quiet moves at all.
+*/
+typedef struct {
+	const Position *position;
+	Pick_Stage stage;
+	Move hash_move;
+	Move killers[KILLERS_LEN + 1]; // and the countermove last
+	bool captures_only;
+	const Ordering *ordering;
+	const Ordering_Node *node;
+	Move_List moves;
+	int scores[MAX_MOVES];
+	int index;
+} Move_Picker;
+
+// hash_move may be MOVE_NONE, killers may be NULL, and neither has to be legal in position
+void move_picker_init(Move_Picker *picker, const Position *position, Move hash_move, const Move *killers);
+// Sorts the quiet moves by the histories of ordering at node, and adds the countermove to the killers
+void move_picker_use_ordering(Move_Picker *picker, const Ordering *ordering, const Ordering_Node *node);
+// Only hands out the captures and promotions, for quiescence search
+void move_picker_init_captures(Move_Picker *picker, const Position *position);
+// The next move to try, MOVE_NONE once every legal move has been handed out
+Move move_picker_next(Move_Picker *picker);
+
+#endif // MOVEPICK_H_
@@ -0,0 +1,121 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "numa.h"
+
+// From linux/mempolicy.h, mbind is called through syscall so that libnuma is not needed
+#define NUMA_MPOL_PREFERRED 1
+#define NUMA_MPOL_INTERLEAVE 3
+
+static struct {
+	int nodes_len;
+	int ids[NUMA_MAX_NODES]; // the kernel's number for each node
+#ifdef __linux__
+	cpu_set_t cpus[NUMA_MAX_NODES];
+#endif
+} numa = {.nodes_len = 1};
+
+#ifdef __linux__
+// Parses a list like "0-15,32-47" into cpus, returning how many there are
+static int parse_cpu_list(const char *text, cpu_set_t *cpus) {
+	CPU_ZERO(cpus);
+	int count = 0;
+	while (*text) {
+		char *end;
+		long first = strtol(text, &end, 10);
+		if (end == text) break;
+		long last = first;
+		if (*end == '-') {
+			text = end + 1;
+			last = strtol(text, &end, 10);
+		}
+		for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu) {
+			CPU_SET(cpu, cpus);
+			++count;
+		}
+		text = *end == ',' ? end + 1: end;
+	}
+	return count;
+}
+
+static bool read_line(const char *path, char *line, int len) {
+	FILE *file = fopen(path, "r");
+	if (file == NULL) return false;
+	bool ok = fgets(line, len, file) != NULL;
+	fclose(file);
+	return ok;
+}
+
+static void mbind_nodes(void *memory, size_t size, int mode, unsigned long mask) {
+	syscall(SYS_mbind, memory, size, mode, &mask, NUMA_MAX_NODES + 1, 0);
+}
+#endif
+
+void numa_init(bool enabled) {
+	numa.nodes_len = 1;
+#ifdef __linux__
+	if (!enabled) return;
+	int nodes_len = 0;
+	for (int id = 0; id < NUMA_MAX_NODES; ++id) {
+		char path[64], line[4096];
+		snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", id);
+		// Nodes are not always numbered contiguously, and memory-only nodes have an empty list
+		if (!read_line(path, line, sizeof(line)) || parse_cpu_list(line, &numa.cpus[nodes_len]) == 0) continue;
+		numa.ids[nodes_len++] = id;
+	}
+	if (nodes_len > 1) numa.nodes_len = nodes_len;
+#else
+	(void)enabled;
+#endif
+}
+
+int numa_nodes(void) {
+	return numa.nodes_len;
+}
+
+int numa_node_of(int index) {
+	return index % numa.nodes_len;
+}
+
+void numa_bind_thread(int index) {
+	if (numa.nodes_len == 1) return;
+#ifdef __linux__
+	pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &numa.cpus[numa_node_of(index)]);
+#endif
+}
+
+void *numa_alloc(size_t size, int index) {
+	void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (memory == MAP_FAILED) return NULL;
+#ifdef __linux__
+	if (numa.nodes_len > 1 && index >= 0) mbind_nodes(memory, size, NUMA_MPOL_PREFERRED, 1ul << numa.ids[numa_node_of(index)]);
+#else
+	(void)index;
+#endif
+	return memory;
+}
+
+void numa_free(void *memory, size_t size) {
+	if (memory) munmap(memory, size);
+}
+
+void numa_interleave(void *memory, size_t size) {
+	if (numa.nodes_len == 1) return;
+#ifdef __linux__
+	unsigned long mask = 0;
+	for (int i = 0; i < numa.nodes_len; ++i) mask |= 1ul << numa.ids[i];
+	mbind_nodes(memory, size, NUMA_MPOL_INTERLEAVE, mask);
+#else
+	(void)memory;
+	(void)size;
+#endif
+}
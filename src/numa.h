@@ -0,0 +1,32 @@
+#ifndef NUMA_H_
+#define NUMA_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define NUMA_MAX_NODES 64
+
+/*
+	Thread placement for machines with more than one memory node. The topology is read once from
+	/sys/devices/system/node, and only nodes that have CPUs are used. Threads are spread over the
+	nodes round robin by an index the caller picks, so that threads 0, 1, 2... alternate between
+	sockets, and are pinned to all the CPUs of their node rather than a single one. Memory for a
+	thread is asked for on the thread's node before any of it is touched.
+
+	Without numa_init(true), on a single node or anywhere but Linux every function here does
+	nothing: threads are left to the scheduler and memory is wherever it is first touched.
+*/
+void numa_init(bool enabled);
+// 1 unless placement is enabled on a machine with several nodes
+int numa_nodes(void);
+int numa_node_of(int index);
+// Pins the calling thread to the CPUs of the node of index
+void numa_bind_thread(int index);
+
+// Zeroed memory, page aligned, on the node of index, or wherever it is first touched for a negative index
+void *numa_alloc(size_t size, int index);
+void numa_free(void *memory, size_t size);
+// Spreads the pages of memory, which has to be page aligned and not yet touched, over every node
+void numa_interleave(void *memory, size_t size);
+
+#endif // NUMA_H_
@@ -0,0 +1,28 @@
+#include <string.h>
+
+#include "ordering.h"
+
+void ordering_new_search(Ordering *ordering) {
+	memset(ordering->killers, 0, sizeof(ordering->killers));
+}
+
+static void update_history(Ordering *ordering, const Ordering_Node *node, const Position *position, Move move, int bonus) {
+	int piece = ordering_piece(position->mailbox[move_from(move)]);
+	ordering_gravity(&ordering->butterfly[position->turn][move_from(move)][move_to(move)], bonus);
+	for (int i = 0; i < ORDERING_CONTINUATIONS; ++i) {
+		if (node->continuations[i]) ordering_gravity(&(*node->continuations[i])[piece][move_to(move)], bonus);
+	}
+}
+
+void ordering_update_cutoff(Ordering *ordering, const Ordering_Node *node, const Position *position, Move move, const Move *tried, int tried_len, int depth) {
+	Move *killers = ordering->killers[node->ply];
+	if (killers[0] != move) {
+		for (int i = KILLERS_LEN-1; i > 0; --i) killers[i] = killers[i-1];
+		killers[0] = move;
+	}
+	if (node->countermove) *node->countermove = move;
+
+	int bonus = ordering_bonus(depth);
+	update_history(ordering, node, position, move, bonus);
+	for (int i = 0; i < tried_len; ++i) update_history(ordering, node, position, tried[i], -bonus);
+}
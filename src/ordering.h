@@ -0,0 +1,69 @@
+#ifndef ORDERING_H_
+#define ORDERING_H_
+
+#include <stdlib.h>
+
+#include "movegen.h"
+#include "pool.h"
+
+#define MAX_PLY 128 // how deep a search can go, which the per-ply tables are sized by
+#define KILLERS_LEN 2
+#define ORDERING_CONTINUATIONS 2 // continuation history is kept for the previous move and the one before it
+#define ORDERING_PIECES 12 // every type but TYPE_NONE of either owner
+#define ORDERING_HISTORY_MAX 16384 // the bound every entry is pulled back towards by gravity
+#define ORDERING_BONUS_MAX 1200
+
+// How well a move of a piece onto a square has done, after some given move
+typedef int16_t Piece_To_History[ORDERING_PIECES][BOARD_LEN];
+
+/*
+	What one searching thread has learned about which quiet moves tend to be good, to try those
+	first. Killers are quiet moves that caused a cutoff at the same ply, countermoves the quiet
+	move that last refuted a given move, butterfly history scores a move by its owner, origin and
+	target over the whole search, and continuation history by the piece that moves and its target
+	after the one or two moves before it. Each thread has its own, so they are never shared.
+*/
+typedef struct {
+	_Alignas(CACHE_LINE) Move killers[MAX_PLY][KILLERS_LEN];
+	_Alignas(CACHE_LINE) Move countermoves[ORDERING_PIECES][BOARD_LEN];
+	_Alignas(CACHE_LINE) int16_t butterfly[OWNER_COUNT][BOARD_LEN][BOARD_LEN];
+	_Alignas(CACHE_LINE) Piece_To_History continuations[ORDERING_PIECES][BOARD_LEN];
+} Ordering;
+
+// The entries that belong to a node, which depend on the moves that led to it
+typedef struct {
+	int ply;
+	Piece_To_History *continuations[ORDERING_CONTINUATIONS]; // NULL where there was no such move
+	Move *countermove; // the slot for the previous move, NULL at the root
+} Ordering_Node;
+
+static inline int ordering_piece(uint8_t packed) {
+	return (PIECE_PACKED_OWNER(packed) - OWNER_WHITE)*(TYPE_COUNT-1) + PIECE_PACKED_TYPE(packed) - TYPE_KING;
+}
+
+// Gravity: the closer an entry already is to the bound, the less a bonus in the same direction moves it
+static inline void ordering_gravity(int16_t *entry, int bonus) {
+	*entry += bonus - *entry*abs(bonus)/ORDERING_HISTORY_MAX;
+}
+
+static inline int ordering_bonus(int depth) {
+	int bonus = 16*depth*depth + 32*depth;
+	return bonus < ORDERING_BONUS_MAX? bonus: ORDERING_BONUS_MAX;
+}
+
+// The combined history of a quiet move, to sort the quiet moves of a node by
+static inline int ordering_score(const Ordering *ordering, const Ordering_Node *node, const Position *position, Move move) {
+	int piece = ordering_piece(position->mailbox[move_from(move)]);
+	int score = ordering->butterfly[position->turn][move_from(move)][move_to(move)];
+	for (int i = 0; i < ORDERING_CONTINUATIONS; ++i) {
+		if (node->continuations[i]) score += (*node->continuations[i])[piece][move_to(move)];
+	}
+	return score;
+}
+
+// Forgets the killers, which only mean anything within one search, the histories are kept
+void ordering_new_search(Ordering *ordering);
+// After a quiet move failed high at node: rewards it and punishes the quiet moves tried before it
+void ordering_update_cutoff(Ordering *ordering, const Ordering_Node *node, const Position *position, Move move, const Move *tried, int tried_len, int depth);
+
+#endif // ORDERING_H_
@@ -0,0 +1,401 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+
+#include "position.h"
+#include "attacks.h"
+#include "movegen.h"
+#include "movepick.h"
+#include "attackmap.h"
+#include "pool.h"
+#include "zobrist.h"
+#include "numa.h"
+
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+
+typedef struct {
+	const char *name;
+	const char *fen;
+	int depth;
+	uint64_t nodes;
+} Perft_Case;
+
+// Reference counts from the chessprogramming wiki and the usual perft collections
+static const Perft_Case suite[] = {
+	{"start",                  START_FEN, 6, 119060324},
+	{"kiwipete",               "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 5, 193690690},
+	{"position 3",             "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 6, 11030083},
+	{"position 4",             "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 5, 15833292},
+	{"position 4 mirrored",    "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1", 5, 15833292},
+	{"position 5",             "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 5, 89941194},
+	{"position 6",             "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 5, 164075551},
+	{"illegal en passant 1",   "3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1", 6, 1134888},
+	{"illegal en passant 2",   "8/8/4k3/8/2p5/8/B2P2K1/8 w - - 0 1", 6, 1015133},
+	{"en passant gives check", "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1", 6, 1440467},
+	{"castling gives check",   "5k2/8/8/8/8/8/8/4K2R w K - 0 1", 6, 661072},
+	{"long castling check",    "3k4/8/8/8/8/8/8/R3K3 w Q - 0 1", 6, 803711},
+	{"castling rights",        "r3k2r/1b4bq/8/8/8/8/7B/R3K2R w KQkq - 0 1", 4, 1274206},
+	{"castling prevented",     "r3k2r/8/3Q4/8/8/5q2/8/R3K2R b KQkq - 0 1", 4, 1720476},
+	{"promote out of check",   "2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1", 6, 3821001},
+	{"discovered check",       "8/8/1P2K3/8/2n5/1q6/8/5k2 b - - 0 1", 5, 1004658},
+	{"promote to give check",  "4k3/1P6/8/8/8/8/K7/8 w - - 0 1", 6, 217342},
+	{"underpromote to check",  "8/P1k5/K7/8/8/8/8/8 w - - 0 1", 6, 92683},
+	{"self stalemate",         "K1k5/8/P7/8/8/8/8/8 w - - 0 1", 6, 2217},
+	{"stalemate and mate",     "8/k1P5/8/1K6/8/8/8/8 w - - 0 1", 7, 567584},
+	{"double check",           "8/8/2k5/5q2/5n2/8/5K2/8 b - - 0 1", 4, 23527},
+};
+#define SUITE_LEN (sizeof(suite)/sizeof(suite[0]))
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+// Leaf moves are counted straight from the generator rather than played out
+static uint64_t perft(Position *position, int depth) {
+	Move_List moves;
+	generate_legal(position, &moves);
+	if (depth <= 1) return depth == 1? (uint64_t)moves.len: 1;
+
+	uint64_t nodes = 0;
+	for (int i = 0; i < moves.len; ++i) {
+		Undo undo = position_make_move(position, moves.moves[i]);
+		nodes += perft(position, depth-1);
+		position_unmake_move(position, moves.moves[i], undo);
+	}
+	return nodes;
+}
+
+/*
+	Counts through the staged move picker instead. The moves last played at the same depth are
+	handed back in as the hash move and killers, which are then often illegal or captures, so
+	this checks that every legal move still comes out exactly once whatever the picker is given.
+*/
+#define STAGED_MAX_DEPTH 64
+static Move staged_hash_moves[STAGED_MAX_DEPTH];
+static Move staged_killers[STAGED_MAX_DEPTH][KILLERS_LEN];
+
+static uint64_t perft_staged(Position *position, int depth) {
+	if (depth == 0) return 1;
+	assert(depth < STAGED_MAX_DEPTH);
+
+	Move_Picker picker;
+	move_picker_init(&picker, position, staged_hash_moves[depth], staged_killers[depth]);
+	uint64_t nodes = 0;
+	Move move;
+	while ((move = move_picker_next(&picker)) != MOVE_NONE) {
+		bool is_capture = position_is_capture(position, move);
+		Undo undo = position_make_move(position, move);
+		nodes += perft_staged(position, depth-1);
+		position_unmake_move(position, move, undo);
+
+		staged_hash_moves[depth] = move;
+		if (!is_capture) {
+			staged_killers[depth][1] = staged_killers[depth][0];
+			staged_killers[depth][0] = move;
+		}
+	}
+	return nodes;
+}
+
+// The same as perft, but with checks and attacked squares read from a map that is kept up to date along the way
+static Attack_Map perft_map;
+
+static uint64_t perft_mapped(Position *position, int depth) {
+	Move_List moves;
+	generate_legal_mapped(position, &perft_map, &moves);
+	if (depth <= 1) return depth == 1? (uint64_t)moves.len: 1;
+
+	uint64_t nodes = 0;
+	for (int i = 0; i < moves.len; ++i) {
+		Undo undo = position_make_move(position, moves.moves[i]);
+		attack_map_update(&perft_map, position, moves.moves[i]);
+		nodes += perft_mapped(position, depth-1);
+		position_unmake_move(position, moves.moves[i], undo);
+		attack_map_update(&perft_map, position, moves.moves[i]);
+	}
+	return nodes;
+}
+
+// Parallel perft
+
+/*
+	Subtree counts are shared between threads without locks: each slot stores the key xor'd with
+	the data next to the data itself, so a slot torn by two concurrent writers fails the key check
+	instead of returning another position's count.
+*/
+typedef struct {
+	_Atomic uint64_t check; // key ^ data
+	_Atomic uint64_t data; // nodes << 8 | depth
+} Perft_Entry;
+
+typedef struct {
+	Perft_Entry *entries;
+	size_t mask;
+} Perft_Table;
+
+// The task tree is split down to this depth, below it a task counts its subtree on its own
+#define PERFT_TASK_DEPTH 4
+#define PERFT_ARENA_CHUNK_LEN 1024
+
+typedef struct {
+	Task task;
+	Position position;
+	int depth;
+	int root; // index of the root move this subtree is under, -1 for the root itself
+} Perft_Task;
+
+typedef struct Perft_Arena_Chunk {
+	struct Perft_Arena_Chunk *next;
+	int used;
+	Perft_Task tasks[PERFT_ARENA_CHUNK_LEN];
+} Perft_Arena_Chunk;
+
+// Tasks are allocated by the worker spawning them and only released once the whole run is over
+typedef struct {
+	_Alignas(CACHE_LINE) Perft_Arena_Chunk *chunks;
+} Perft_Arena;
+
+static struct {
+	Pool pool;
+	Perft_Table table;
+	Perft_Arena arenas[POOL_MAX_WORKERS];
+	_Atomic uint64_t root_nodes[MAX_MOVES];
+} parallel;
+
+static uint64_t perft_hashed(Position *position, int depth) {
+	if (depth <= 1 || parallel.table.entries == NULL) return perft(position, depth);
+
+	uint64_t key = position->key;
+	Perft_Entry *entry = &parallel.table.entries[key & parallel.table.mask];
+	uint64_t data = atomic_load_explicit(&entry->data, memory_order_relaxed);
+	uint64_t check = atomic_load_explicit(&entry->check, memory_order_relaxed);
+	if ((check ^ data) == key && (data & 0xFF) == (uint64_t)depth) return data >> 8;
+
+	Move_List moves;
+	generate_legal(position, &moves);
+	uint64_t nodes = 0;
+	for (int i = 0; i < moves.len; ++i) {
+		Undo undo = position_make_move(position, moves.moves[i]);
+		nodes += perft_hashed(position, depth-1);
+		position_unmake_move(position, moves.moves[i], undo);
+	}
+
+	data = nodes << 8 | (uint64_t)depth;
+	atomic_store_explicit(&entry->check, key ^ data, memory_order_relaxed);
+	atomic_store_explicit(&entry->data, data, memory_order_relaxed);
+	return nodes;
+}
+
+static Perft_Task *perft_task_alloc(Pool_Worker *worker) {
+	Perft_Arena *arena = &parallel.arenas[worker->id];
+	if (arena->chunks == NULL || arena->chunks->used == PERFT_ARENA_CHUNK_LEN) {
+		Perft_Arena_Chunk *chunk = malloc(sizeof(Perft_Arena_Chunk));
+		assert(chunk != NULL);
+		chunk->next = arena->chunks;
+		chunk->used = 0;
+		arena->chunks = chunk;
+	}
+	return &arena->chunks->tasks[arena->chunks->used++];
+}
+
+static void perft_arenas_free(void) {
+	for (int i = 0; i < POOL_MAX_WORKERS; ++i) {
+		while (parallel.arenas[i].chunks) {
+			Perft_Arena_Chunk *next = parallel.arenas[i].chunks->next;
+			free(parallel.arenas[i].chunks);
+			parallel.arenas[i].chunks = next;
+		}
+	}
+}
+
+static void perft_task_run(Pool_Worker *worker, Task *task) {
+	Perft_Task *perft_task = (Perft_Task *)task;
+	if (perft_task->depth <= PERFT_TASK_DEPTH) {
+		uint64_t nodes = perft_hashed(&perft_task->position, perft_task->depth);
+		worker->nodes += nodes;
+		if (perft_task->root >= 0) atomic_fetch_add(&parallel.root_nodes[perft_task->root], nodes);
+		return;
+	}
+
+	Move_List moves;
+	generate_legal(&perft_task->position, &moves);
+	for (int i = 0; i < moves.len; ++i) {
+		Perft_Task *child = perft_task_alloc(worker);
+		child->task.run = perft_task_run;
+		child->position = perft_task->position;
+		position_make_move(&child->position, moves.moves[i]);
+		child->depth = perft_task->depth - 1;
+		child->root = perft_task->root < 0? i: perft_task->root;
+		pool_spawn(worker, &child->task);
+	}
+}
+
+static void parallel_init(int threads, size_t hash_mb) {
+	pool_init(&parallel.pool, threads);
+	if (hash_mb == 0) return;
+	size_t entries_len = 1;
+	while (2*entries_len*sizeof(Perft_Entry) <= hash_mb << 20) entries_len *= 2;
+	parallel.table.entries = calloc(entries_len, sizeof(Perft_Entry));
+	assert(parallel.table.entries != NULL);
+	parallel.table.mask = entries_len - 1;
+}
+
+static uint64_t parallel_perft(const Position *position, int depth) {
+	Perft_Task root = {.task.run = perft_task_run, .position = *position, .depth = depth, .root = -1};
+	for (int i = 0; i < MAX_MOVES; ++i) atomic_store(&parallel.root_nodes[i], 0);
+	pool_reset_stats(&parallel.pool);
+	pool_run(&parallel.pool, &root.task);
+	perft_arenas_free();
+
+	uint64_t nodes = 0;
+	for (int i = 0; i < parallel.pool.workers_len; ++i) nodes += parallel.pool.workers[i]->nodes;
+	return nodes;
+}
+
+static void parallel_report(void) {
+	for (int i = 0; i < parallel.pool.workers_len; ++i) {
+		Pool_Worker *worker = parallel.pool.workers[i];
+		printf("Thread %3d: %14llu nodes %8llu tasks %8llu steals %10llu steal attempts\n", i,
+			(unsigned long long)worker->nodes, (unsigned long long)worker->tasks,
+			(unsigned long long)worker->steals, (unsigned long long)worker->steal_attempts);
+	}
+}
+
+static bool is_parallel = false;
+static bool is_staged = false;
+static bool is_mapped = false;
+
+static uint64_t count(Position *position, int depth) {
+	if (is_staged) return perft_staged(position, depth);
+	if (is_mapped) {
+		attack_map_init(&perft_map, position);
+		return perft_mapped(position, depth);
+	}
+	return is_parallel? parallel_perft(position, depth): perft(position, depth);
+}
+
+static uint64_t divide(Position *position, int depth) {
+	Move_List moves;
+	generate_legal(position, &moves);
+	uint64_t move_nodes[MAX_MOVES];
+	uint64_t nodes = 0;
+	if (is_parallel && depth > 1) {
+		nodes = parallel_perft(position, depth);
+		for (int i = 0; i < moves.len; ++i) move_nodes[i] = atomic_load(&parallel.root_nodes[i]);
+	} else {
+		for (int i = 0; i < moves.len; ++i) {
+			Undo undo = position_make_move(position, moves.moves[i]);
+			move_nodes[i] = perft(position, depth-1);
+			position_unmake_move(position, moves.moves[i], undo);
+			nodes += move_nodes[i];
+		}
+	}
+
+	for (int i = 0; i < moves.len; ++i) {
+		char name[10];
+		move_name(moves.moves[i], name);
+		printf("%s: %llu\n", name, (unsigned long long)move_nodes[i]);
+	}
+	printf("\nMoves: %d\n", moves.len);
+	return nodes;
+}
+
+static void report(uint64_t nodes, double seconds) {
+	printf("Nodes: %llu\nTime: %.3fs\nNPS: %.0f\n", (unsigned long long)nodes, seconds, nodes/seconds);
+}
+
+// Runs every reference position, capped at max_depth, and returns how many of them did not match
+static int run_suite(int max_depth) {
+	int failures = 0;
+	uint64_t total_nodes = 0;
+	double total_seconds = 0;
+	for (size_t i = 0; i < SUITE_LEN; ++i) {
+		Position position;
+		if (!position_from_fen(&position, suite[i].fen)) {
+			printf("%-24s invalid fen\n", suite[i].name);
+			++failures;
+			continue;
+		}
+		int depth = suite[i].depth < max_depth? suite[i].depth: max_depth;
+		double start = now();
+		uint64_t nodes = count(&position, depth);
+		double seconds = now() - start;
+		total_nodes += nodes;
+		total_seconds += seconds;
+
+		// Reference counts only exist for the full depth, shallower runs are reported without a check
+		const char *status = depth != suite[i].depth? "    ": nodes == suite[i].nodes? "ok  ": "FAIL";
+		if (depth == suite[i].depth && nodes != suite[i].nodes) ++failures;
+		printf("%s %-24s depth %d %12llu nodes %7.3fs %8.2f Mnps\n", status, suite[i].name, depth, (unsigned long long)nodes, seconds, nodes/seconds/1e6);
+	}
+	printf("\n");
+	report(total_nodes, total_seconds);
+	printf("Failures: %d\n", failures);
+	return failures;
+}
+
+static void usage(const char *program) {
+	fprintf(stderr, "Usage: %s [options] <depth> [fen]         count the leaf nodes at depth\n", program);
+	fprintf(stderr, "       %s [options] divide <depth> [fen]  count them separately for every root move\n", program);
+	fprintf(stderr, "       %s [options] suite [max depth]     check the reference positions\n", program);
+	fprintf(stderr, "Options:\n");
+	fprintf(stderr, "       -threads <n>     split the tree over n threads\n");
+	fprintf(stderr, "       -hash <mb>       share subtree counts in a table of the given size\n");
+	fprintf(stderr, "       -gen <kind>      \"legal\" generates every move at once, \"staged\" goes through the move picker (single-threaded)\n");
+	fprintf(stderr, "       -attacks <kind>  \"bitboards\" recomputes attacks at every node, \"map\" keeps them up to date incrementally (single-threaded)\n");
+	fprintf(stderr, "       -numa <on|off>   pin threads to NUMA nodes and allocate their memory there (default on)\n");
+}
+
+int main(int argc, char **argv) {
+	int arg = 1;
+	int threads = 1;
+	size_t hash_mb = 0;
+	bool is_numa = true;
+	for (; arg+1 < argc && argv[arg][0] == '-'; arg += 2) {
+		if (strcmp(argv[arg], "-threads") == 0) threads = atoi(argv[arg+1]);
+		else if (strcmp(argv[arg], "-hash") == 0) hash_mb = strtoull(argv[arg+1], NULL, 10);
+		else if (strcmp(argv[arg], "-gen") == 0) is_staged = strcmp(argv[arg+1], "staged") == 0;
+		else if (strcmp(argv[arg], "-attacks") == 0) is_mapped = strcmp(argv[arg+1], "map") == 0;
+		else if (strcmp(argv[arg], "-numa") == 0) is_numa = strcmp(argv[arg+1], "off") != 0;
+		else break;
+	}
+	if (arg >= argc || threads < 1 || threads > POOL_MAX_WORKERS || ((is_staged || is_mapped) && (threads > 1 || hash_mb > 0))) {
+		usage(argv[0]);
+		return 1;
+	}
+	attacks_init();
+	zobrist_init();
+	// Before the pool, whose workers are placed and allocated by it
+	numa_init(is_numa);
+	is_parallel = threads > 1 || hash_mb > 0;
+	if (is_parallel) parallel_init(threads, hash_mb);
+
+	if (strcmp(argv[arg], "suite") == 0) {
+		return run_suite(arg+1 < argc? atoi(argv[arg+1]): 99) == 0? 0: 1;
+	}
+
+	bool is_divide = strcmp(argv[arg], "divide") == 0;
+	if (is_divide) ++arg;
+	if (arg >= argc) {
+		usage(argv[0]);
+		return 1;
+	}
+	int depth = atoi(argv[arg++]);
+	const char *fen = arg < argc? argv[arg]: START_FEN;
+
+	Position position;
+	if (!position_from_fen(&position, fen)) {
+		fprintf(stderr, "Invalid fen: %s\n", fen);
+		return 1;
+	}
+
+	double start = now();
+	uint64_t nodes = is_divide? divide(&position, depth): count(&position, depth);
+	report(nodes, now() - start);
+	if (is_parallel) parallel_report();
+	return 0;
+}
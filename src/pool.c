@@ -0,0 +1,163 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+
+#include "pool.h"
+#include "numa.h"
+
+// Deque operations follow "Correct and Efficient Work-Stealing for Weak Memory Models" (Lê et al.)
+
+static void deque_push(Pool_Deque *deque, Task *task) {
+	int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+	int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+	assert(bottom - top < POOL_DEQUE_LEN && "Work-stealing deque is full");
+	(void)top;
+	atomic_store_explicit(&deque->items[bottom % POOL_DEQUE_LEN], task, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+}
+
+static Task *deque_pop(Pool_Deque *deque) {
+	int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+	atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	int64_t top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+	if (top > bottom) {
+		atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+		return NULL;
+	}
+	Task *task = atomic_load_explicit(&deque->items[bottom % POOL_DEQUE_LEN], memory_order_relaxed);
+	if (top == bottom) {
+		// Last item, a thief may be after it as well
+		if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed)) task = NULL;
+		atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+	}
+	return task;
+}
+
+static Task *deque_steal(Pool_Deque *deque) {
+	int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+	atomic_thread_fence(memory_order_seq_cst);
+	int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+	if (top >= bottom) return NULL;
+
+	Task *task = atomic_load_explicit(&deque->items[top % POOL_DEQUE_LEN], memory_order_relaxed);
+	if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed)) return NULL;
+	return task;
+}
+
+static uint64_t worker_rand(Pool_Worker *worker) {
+	worker->rand_state ^= worker->rand_state >> 12;
+	worker->rand_state ^= worker->rand_state << 25;
+	worker->rand_state ^= worker->rand_state >> 27;
+	return worker->rand_state * 0x2545F4914F6CDD1Dull;
+}
+
+static Task *find_task(Pool_Worker *worker) {
+	Task *task = deque_pop(&worker->deque);
+	if (task) return task;
+
+	Pool *pool = worker->pool;
+	if (pool->workers_len < 2) return NULL;
+	for (int i = 0; i < pool->workers_len; ++i) {
+		Pool_Worker *victim = pool->workers[worker_rand(worker) % pool->workers_len];
+		if (victim == worker) continue;
+		++worker->steal_attempts;
+		task = deque_steal(&victim->deque);
+		if (task) {
+			++worker->steals;
+			return task;
+		}
+	}
+	return NULL;
+}
+
+static void work(Pool_Worker *worker) {
+	Pool *pool = worker->pool;
+	while (atomic_load(&pool->pending) > 0) {
+		Task *task = find_task(worker);
+		if (!task) {
+			sched_yield();
+			continue;
+		}
+		task->run(worker, task);
+		++worker->tasks;
+		atomic_fetch_sub(&pool->pending, 1);
+	}
+}
+
+static void *worker_main(void *arg) {
+	Pool_Worker *worker = arg;
+	Pool *pool = worker->pool;
+	numa_bind_thread(worker->id);
+	uint64_t seen = 0;
+	for (;;) {
+		pthread_mutex_lock(&pool->mutex);
+		while (!pool->quit && pool->generation == seen) pthread_cond_wait(&pool->wake, &pool->mutex);
+		seen = pool->generation;
+		bool quit = pool->quit;
+		pthread_mutex_unlock(&pool->mutex);
+		if (quit) return NULL;
+
+		work(worker);
+		atomic_fetch_sub(&pool->active, 1);
+	}
+}
+
+void pool_init(Pool *pool, int workers_len) {
+	assert(0 < workers_len && workers_len <= POOL_MAX_WORKERS);
+	memset(pool, 0, sizeof(*pool));
+	pool->workers_len = workers_len;
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->wake, NULL);
+
+	for (int i = 0; i < workers_len; ++i) {
+		// Worker 0 is the calling thread, which is left wherever it is
+		Pool_Worker *worker = pool->workers[i] = numa_alloc(sizeof(Pool_Worker), i == 0? -1: i);
+		assert(worker != NULL);
+		worker->pool = pool;
+		worker->id = i;
+		worker->rand_state = 0x9E3779B97F4A7C15ull * (i + 1);
+		if (i > 0) pthread_create(&worker->thread, NULL, worker_main, worker);
+	}
+}
+
+void pool_free(Pool *pool) {
+	pthread_mutex_lock(&pool->mutex);
+	pool->quit = true;
+	pthread_cond_broadcast(&pool->wake);
+	pthread_mutex_unlock(&pool->mutex);
+	for (int i = 1; i < pool->workers_len; ++i) pthread_join(pool->workers[i]->thread, NULL);
+	pthread_cond_destroy(&pool->wake);
+	pthread_mutex_destroy(&pool->mutex);
+	for (int i = 0; i < pool->workers_len; ++i) numa_free(pool->workers[i], sizeof(Pool_Worker));
+}
+
+void pool_run(Pool *pool, Task *root) {
+	atomic_store(&pool->pending, 1);
+	atomic_store(&pool->active, pool->workers_len - 1);
+	deque_push(&pool->workers[0]->deque, root);
+
+	pthread_mutex_lock(&pool->mutex);
+	++pool->generation;
+	pthread_cond_broadcast(&pool->wake);
+	pthread_mutex_unlock(&pool->mutex);
+
+	work(pool->workers[0]);
+	// Every task is done, but the others may still be looking for one, and their statistics are not final until they stop
+	while (atomic_load(&pool->active) > 0) sched_yield();
+}
+
+void pool_spawn(Pool_Worker *worker, Task *task) {
+	atomic_fetch_add(&worker->pool->pending, 1);
+	deque_push(&worker->deque, task);
+}
+
+void pool_reset_stats(Pool *pool) {
+	for (int i = 0; i < pool->workers_len; ++i) {
+		Pool_Worker *worker = pool->workers[i];
+		worker->tasks = worker->steals = worker->steal_attempts = worker->nodes = 0;
+	}
+}
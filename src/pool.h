@@ -0,0 +1,63 @@
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#define POOL_DEQUE_LEN 4096
+#define POOL_MAX_WORKERS 256
+#define CACHE_LINE 64
+
+typedef struct Pool_Worker Pool_Worker;
+typedef struct Task Task;
+
+// Embedded as the first member of whatever a task needs to carry, the owner allocates it
+struct Task {
+	void (*run)(Pool_Worker *worker, Task *task);
+};
+
+// Chase-Lev deque: the owning worker pushes and pops at the bottom, thieves take from the top
+typedef struct {
+	_Alignas(CACHE_LINE) _Atomic int64_t top;
+	_Alignas(CACHE_LINE) _Atomic int64_t bottom;
+	_Alignas(CACHE_LINE) _Atomic(Task *) items[POOL_DEQUE_LEN];
+} Pool_Deque;
+
+typedef struct Pool Pool;
+
+struct Pool_Worker {
+	Pool_Deque deque;
+	Pool *pool;
+	int id;
+	uint64_t rand_state;
+	pthread_t thread;
+	// Statistics, only written by the worker itself
+	uint64_t tasks;
+	uint64_t steals;
+	uint64_t steal_attempts;
+	uint64_t nodes; // for the tasks to count their own work in
+};
+
+struct Pool {
+	Pool_Worker *workers[POOL_MAX_WORKERS]; // each allocated on the NUMA node of its worker
+	int workers_len;
+	_Alignas(CACHE_LINE) _Atomic int64_t pending; // tasks spawned but not yet finished
+	_Atomic int active; // helper workers that have not yet noticed the run is over
+	pthread_mutex_t mutex;
+	pthread_cond_t wake;
+	uint64_t generation;
+	bool quit;
+};
+
+// Worker 0 is the thread that calls pool_run, the others are started here
+void pool_init(Pool *pool, int workers_len);
+void pool_free(Pool *pool);
+// Runs root and everything it spawns on all workers, returning once no task is left
+void pool_run(Pool *pool, Task *root);
+// Makes task available to every worker, only to be called from inside a running task
+void pool_spawn(Pool_Worker *worker, Task *task);
+void pool_reset_stats(Pool *pool);
+
+#endif // POOL_H_
@@ -0,0 +1,263 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <assert.h>
+
+#include "position.h"
+#include "zobrist.h"
+#include "movegen.h"
+
+bool pos_eq(Pos a, Pos b) {
+	return a.x == b.x && a.y == b.y;
+}
+
+Piece_Owner owner_next(Piece_Owner owner) {
+	switch (owner) {
+	case OWNER_NONE: return OWNER_NONE; // degenerate case
+	case OWNER_WHITE: return OWNER_BLACK;
+	case OWNER_BLACK: return OWNER_WHITE;
+	}
+	assert(false && "Unreachable");
+	return OWNER_NONE;
+}
+
+int owner_direction(Piece_Owner owner) {
+	switch (owner) {
+	case OWNER_NONE: return 0;
+	case OWNER_WHITE: return -1;
+	case OWNER_BLACK: return 1;
+	}
+	assert(false && "Unreachable");
+	return 0;
+}
+
+Bitboard owner_promotion_row(Piece_Owner owner) {
+	switch (owner) {
+	case OWNER_NONE: return BB_EMPTY;
+	case OWNER_WHITE: return BB_ROW(0);
+	case OWNER_BLACK: return BB_ROW(ROWS-1);
+	}
+	assert(false && "Unreachable");
+	return BB_EMPTY;
+}
+
+bool piece_is_empty(Piece piece) {
+	return piece.owner == OWNER_NONE || piece.type == TYPE_NONE;
+}
+
+void position_clear(Position *position) {
+	memset(position, 0, sizeof(*position));
+	position->double_move = SQUARE_NONE;
+	memset(position->castling_rooks, SQUARE_NONE, sizeof(position->castling_rooks));
+}
+
+void position_put(Position *position, Square sq, Piece piece) {
+	assert(position->mailbox[sq] == 0 && "Square is occupied");
+	if (piece_is_empty(piece)) return;
+	Bitboard bb = BB_SQUARE(sq);
+	position->by_type[piece.type] |= bb;
+	position->by_owner[piece.owner] |= bb;
+	position->occupied |= bb;
+	position->mailbox[sq] = PIECE_PACK(piece.type, piece.owner);
+	position->key ^= zobrist_pieces[position->mailbox[sq]][sq];
+}
+
+Piece position_remove(Position *position, Square sq) {
+	Piece piece = position_at(position, sq);
+	if (piece_is_empty(piece)) return piece;
+	Bitboard bb = BB_SQUARE(sq);
+	position->by_type[piece.type] ^= bb;
+	position->by_owner[piece.owner] ^= bb;
+	position->occupied ^= bb;
+	position->key ^= zobrist_pieces[position->mailbox[sq]][sq];
+	position->mailbox[sq] = 0;
+	return piece;
+}
+
+void position_move(Position *position, Square from, Square to) {
+	position_put(position, to, position_remove(position, from));
+}
+
+uint64_t position_compute_key(const Position *position) {
+	uint64_t key = zobrist_state(position->castling, position->double_move);
+	if (position->turn == OWNER_BLACK) key ^= zobrist_turn;
+	Square sq;
+	BB_FOREACH(sq, position->occupied) key ^= zobrist_pieces[position->mailbox[sq]][sq];
+	return key;
+}
+
+static void reset_start_and_end_row(Position *position, int row, Piece_Owner owner, uint8_t left_idx) {
+	static const Piece_Type back_rank[8] = {
+		TYPE_ROOK, TYPE_KNIGHT, TYPE_BISHOP, TYPE_QUEEN, TYPE_KING, TYPE_BISHOP, TYPE_KNIGHT, TYPE_ROOK
+	};
+	for (int col = 0; col < 8; ++col) position_put(position, SQUARE(row, col+left_idx), (Piece){back_rank[col], owner});
+}
+
+static void reset_pawn_row(Position *position, int row, Piece_Owner owner, uint8_t left_idx) {
+	for (int col = 0; col < 8; ++col) position_put(position, SQUARE(row, col+left_idx), (Piece){TYPE_PAWN, owner});
+}
+
+static void reset_castling_rooks(Position *position, uint8_t left_idx) {
+	position->castling_rooks[0] = SQUARE(ROWS-1, left_idx);
+	position->castling_rooks[1] = SQUARE(ROWS-1, left_idx+7);
+	position->castling_rooks[2] = SQUARE(0, left_idx);
+	position->castling_rooks[3] = SQUARE(0, left_idx+7);
+}
+
+void position_reset(Position *position) {
+	position_clear(position);
+
+	assert(COLS >= 8);
+	uint8_t left_idx = (COLS-8)>>1;
+
+	reset_start_and_end_row(position, 0, OWNER_BLACK, left_idx);
+	reset_pawn_row(position, 1, OWNER_BLACK, left_idx);
+	reset_pawn_row(position, ROWS-2, OWNER_WHITE, left_idx);
+	reset_start_and_end_row(position, ROWS-1, OWNER_WHITE, left_idx);
+
+	position->turn = OWNER_WHITE;
+	position->castling = CASTLE_WHITE_LEFT | CASTLE_WHITE_RIGHT | CASTLE_BLACK_LEFT | CASTLE_BLACK_RIGHT;
+	reset_castling_rooks(position, left_idx);
+	position->key = position_compute_key(position);
+}
+
+static Piece_Type fen_piece_type(char c) {
+	switch (tolower(c)) {
+	case 'k': return TYPE_KING;
+	case 'q': return TYPE_QUEEN;
+	case 'b': return TYPE_BISHOP;
+	case 'n': return TYPE_KNIGHT;
+	case 'r': return TYPE_ROOK;
+	case 'p': return TYPE_PAWN;
+	default: return TYPE_NONE;
+	}
+}
+
+// Rows are listed from row 0 (black's back rank) down, which is also the order the squares are numbered in
+bool position_from_fen(Position *position, const char *fen) {
+	position_clear(position);
+	reset_castling_rooks(position, (COLS-8)>>1);
+
+	int row = 0, col = 0;
+	for (; *fen && *fen != ' '; ++fen) {
+		if (*fen == '/') {
+			if (col != COLS) return false;
+			++row;
+			col = 0;
+		} else if (isdigit(*fen)) {
+			char *end;
+			col += strtol(fen, &end, 10); // gaps can take two digits on wide boards
+			fen = end - 1;
+		} else {
+			Piece_Type type = fen_piece_type(*fen);
+			if (type == TYPE_NONE || col >= COLS || row >= ROWS) return false;
+			position_put(position, SQUARE(row, col), (Piece){type, isupper(*fen)? OWNER_WHITE: OWNER_BLACK});
+			++col;
+		}
+		if (col > COLS) return false;
+	}
+	if (row != ROWS-1 || col != COLS) return false;
+	if (bb_count(position_pieces(position, OWNER_WHITE, TYPE_KING)) != 1) return false;
+	if (bb_count(position_pieces(position, OWNER_BLACK, TYPE_KING)) != 1) return false;
+
+	char turn = 'w', castling[8] = "-", double_move[4] = "-";
+	int halfmove = 0;
+	sscanf(fen, " %c %7s %3s %d", &turn, castling, double_move, &halfmove);
+	if (turn != 'w' && turn != 'b') return false;
+	if (halfmove < 0 || halfmove > UINT16_MAX) return false;
+	position->halfmove = halfmove;
+	position->turn = turn == 'w'? OWNER_WHITE: OWNER_BLACK;
+
+	for (char *c = castling; *c && *c != '-'; ++c) {
+		switch (*c) {
+		case 'K': position->castling |= CASTLE_WHITE_RIGHT; break;
+		case 'Q': position->castling |= CASTLE_WHITE_LEFT;  break;
+		case 'k': position->castling |= CASTLE_BLACK_RIGHT; break;
+		case 'q': position->castling |= CASTLE_BLACK_LEFT;  break;
+		default: return false;
+		}
+	}
+
+	if (double_move[0] != '-') {
+		int double_col = double_move[0] - 'a', double_row = ROWS - atoi(double_move+1);
+		if (!(0 <= double_col && double_col < COLS && 0 <= double_row && double_row < ROWS)) return false;
+		position->double_move = SQUARE(double_row, double_col);
+	}
+
+	// Everything else assumes exactly one king a side, and that the side to move cannot capture the other one
+	for (Piece_Owner owner = OWNER_WHITE; owner <= OWNER_BLACK; ++owner) {
+		if (bb_count(position_pieces(position, owner, TYPE_KING)) != 1) return false;
+	}
+	Piece_Owner them = owner_next(position->turn);
+	if (position_attackers(position, position_king(position, them), position->occupied) & position->by_owner[position->turn]) return false;
+	position->key = position_compute_key(position);
+	return true;
+}
+
+void square_name(Square sq, char *name) {
+	int number = ROWS - SQUARE_ROW(sq);
+	*name++ = 'a' + SQUARE_COL(sq);
+	if (number >= 10) *name++ = '0' + number/10;
+	*name++ = '0' + number%10;
+	*name = '\0';
+}
+
+// Castling rights that are lost once a piece leaves or lands on sq, i.e. when a king or one of its rooks moves or is captured
+uint8_t position_castling_lost(const Position *position, Square sq) {
+	uint8_t lost = 0;
+	for (int i = 0; i < 4; ++i) {
+		Square rook = position->castling_rooks[i];
+		if (rook == SQUARE_NONE) continue;
+		if (sq == rook || sq == SQUARE(SQUARE_ROW(rook), CASTLING_KING_COL)) lost |= 1 << i;
+	}
+	return lost;
+}
+
+Square position_castling_rook(const Position *position, Square king, int dir) {
+	uint8_t rights = position->castling & CASTLE_OWNER(position->turn);
+	for (int i = 0; i < 4; ++i) {
+		Square rook = position->castling_rooks[i];
+		if (!(rights & (1 << i))) continue;
+		if ((SQUARE_COL(rook) > SQUARE_COL(king)) == (dir > 0)) return rook;
+	}
+	return SQUARE_NONE;
+}
+
+// Attacks
+
+Bitboard line_attacks(Square sq, Bitboard occupied, int8_t left, int8_t up, uint8_t distance) {
+	return bb_ray(BB_SQUARE(sq), left, up, ~occupied, distance);
+}
+
+// Traces the four rotations of (left, up), as the bishop (1, 1) and rook (1, 0) rays are all rotations of each other
+Bitboard lines_attacks(Square sq, Bitboard occupied, int8_t left, int8_t up, uint8_t distance) {
+	return line_attacks(sq, occupied, left, up, distance)
+		| line_attacks(sq, occupied, -up, left, distance)
+		| line_attacks(sq, occupied, -left, -up, distance)
+		| line_attacks(sq, occupied, up, -left, distance);
+}
+
+Bitboard knight_attacks(Bitboard knights) {
+	return bb_shift(knights, 2, 1) | bb_shift(knights, -1, 2) | bb_shift(knights, -2, -1) | bb_shift(knights, 1, -2)
+		| bb_shift(knights, 1, 2) | bb_shift(knights, -2, 1) | bb_shift(knights, -1, -2) | bb_shift(knights, 2, -1);
+}
+
+Bitboard king_attacks(Bitboard kings) {
+	Bitboard sides = kings | bb_shift(kings, 1, 0) | bb_shift(kings, -1, 0);
+	return (sides | bb_shift(sides, 0, 1) | bb_shift(sides, 0, -1)) ^ kings;
+}
+
+Bitboard pawn_attacks(Bitboard pawns, Piece_Owner colour) {
+	int dy = owner_direction(colour);
+	return bb_shift(pawns, -1, dy) | bb_shift(pawns, 1, dy);
+}
+
+// Single pushes onto empty squares, plus double pushes for pawns that are still on their starting row
+Bitboard pawn_pushes(Bitboard pawns, Piece_Owner colour, Bitboard empty) {
+	int dy = owner_direction(colour);
+	Bitboard start_row = BB_ROW(colour == OWNER_WHITE? ROWS-2: 1);
+	Bitboard single = bb_shift(pawns, 0, dy) & empty;
+	Bitboard twice = bb_shift(bb_shift(pawns & start_row, 0, dy) & empty, 0, dy) & empty;
+	return single | twice;
+}
@@ -0,0 +1,127 @@
+#ifndef POSITION_H_
+#define POSITION_H_
+
+#include "bitboard.h"
+
+typedef struct {
+	uint8_t x;
+	uint8_t y;
+} Pos;
+
+bool pos_eq(Pos a, Pos b);
+
+static inline Square pos_square(Pos pos) {
+	return SQUARE(pos.y, pos.x);
+}
+
+static inline Pos square_pos(Square sq) {
+	return (Pos){SQUARE_COL(sq), SQUARE_ROW(sq)};
+}
+
+// Pieces
+
+// should be in the same order as the sprite map (left to right)
+typedef enum {
+	TYPE_NONE,
+	TYPE_KING,
+	TYPE_QUEEN,
+	TYPE_BISHOP,
+	TYPE_KNIGHT,
+	TYPE_ROOK,
+	TYPE_PAWN
+} Piece_Type;
+#define TYPE_COUNT 7
+
+// should be in the same order as the sprite map (top to bottom)
+// OWNER_NONE should always be first
+typedef enum {
+	OWNER_NONE,
+	OWNER_WHITE,
+	OWNER_BLACK
+} Piece_Owner;
+#define OWNER_COUNT 3
+
+Piece_Owner owner_next(Piece_Owner owner);
+int owner_direction(Piece_Owner owner);
+Bitboard owner_promotion_row(Piece_Owner owner);
+
+typedef struct {
+	Piece_Type type;
+	Piece_Owner owner;
+} Piece;
+
+bool piece_is_empty(Piece piece);
+
+// The mailbox packs a piece into a single byte, so the whole board is one cache line on 8x8
+#define PIECE_PACK(type, owner) ((uint8_t)(((owner) << 3) | (type)))
+#define PIECE_PACKED_TYPE(packed) ((Piece_Type)((packed) & 7))
+#define PIECE_PACKED_OWNER(packed) ((Piece_Owner)((packed) >> 3))
+
+// Position
+
+typedef enum {
+	CASTLE_WHITE_LEFT  = 1 << 0,
+	CASTLE_WHITE_RIGHT = 1 << 1,
+	CASTLE_BLACK_LEFT  = 1 << 2,
+	CASTLE_BLACK_RIGHT = 1 << 3,
+} Castling_Right;
+
+#define CASTLE_OWNER(owner) ((owner) == OWNER_WHITE? CASTLE_WHITE_LEFT | CASTLE_WHITE_RIGHT: CASTLE_BLACK_LEFT | CASTLE_BLACK_RIGHT)
+
+/*
+	One occupancy word per piece type and per owner, with a mailbox kept in sync for
+	"what is on this square" queries. The TYPE_NONE and OWNER_NONE slots are unused.
+*/
+typedef struct {
+	Bitboard by_type[TYPE_COUNT];
+	Bitboard by_owner[OWNER_COUNT];
+	Bitboard occupied;
+	uint8_t mailbox[BOARD_LEN];
+	Piece_Owner turn;
+	uint8_t castling; // Castling_Right flags, replaces tracking whether the kings and rooks have moved
+	Square double_move; // Square skipped by a double move on the previous turn, SQUARE_NONE otherwise
+	Square castling_rooks[4]; // Starting square of the rook for each castling right, indexed by bit
+	uint16_t halfmove; // Plies since the last capture or pawn move, for the fifty-move rule
+	uint64_t key; // Zobrist key, see zobrist.h
+} Position;
+
+static inline Piece position_at(const Position *position, Square sq) {
+	uint8_t packed = position->mailbox[sq];
+	return (Piece){PIECE_PACKED_TYPE(packed), PIECE_PACKED_OWNER(packed)};
+}
+
+static inline Bitboard position_pieces(const Position *position, Piece_Owner owner, Piece_Type type) {
+	return position->by_owner[owner] & position->by_type[type];
+}
+
+static inline Square position_king(const Position *position, Piece_Owner owner) {
+	return bb_first(position_pieces(position, owner, TYPE_KING));
+}
+
+void position_clear(Position *position);
+void position_reset(Position *position);
+// Returns false if fen is malformed or the position illegal (not one king a side, or the side not to move in check), leaving position in an unspecified state
+bool position_from_fen(Position *position, const char *fen);
+// Writes the coordinate name of sq (e.g. "e4") into name, which needs room for 4 characters
+void square_name(Square sq, char *name);
+void position_put(Position *position, Square sq, Piece piece);
+Piece position_remove(Position *position, Square sq);
+void position_move(Position *position, Square from, Square to);
+// The key worked out from scratch, which the incrementally updated position->key should always equal
+uint64_t position_compute_key(const Position *position);
+
+#define CASTLING_KING_COL (((COLS-8)>>1)+4)
+uint8_t position_castling_lost(const Position *position, Square sq);
+// The rook that the side to move castles with when its king on king goes in direction dir (-1 or 1), SQUARE_NONE if there is no such right
+Square position_castling_rook(const Position *position, Square king, int dir);
+
+// Pseudo-legal targets, each returned as a mask
+
+Bitboard line_attacks(Square sq, Bitboard occupied, int8_t left, int8_t up, uint8_t distance);
+Bitboard lines_attacks(Square sq, Bitboard occupied, int8_t left, int8_t up, uint8_t distance);
+Bitboard knight_attacks(Bitboard knights);
+Bitboard king_attacks(Bitboard kings);
+Bitboard pawn_attacks(Bitboard pawns, Piece_Owner colour);
+Bitboard pawn_pushes(Bitboard pawns, Piece_Owner colour, Bitboard empty);
+
+#endif // POSITION_H_
@@ -0,0 +1,55 @@
+#ifndef REPETITION_H_
+#define REPETITION_H_
+
+#include "position.h"
+
+#define FIFTY_MOVE_PLIES 100
+/*
+	A power of two. Only the newer half of the ring is ever looked at, as a search may have pushed
+	over the older half and popped again since, and that half still covers the fifty-move window
+	plus the deepest search on top of it: nothing before the last irreversible move can repeat.
+*/
+#define KEY_HISTORY_LEN 512
+#define KEY_HISTORY_MASK (KEY_HISTORY_LEN - 1)
+
+// A ring of the keys of the positions reached so far, the current one last
+typedef struct {
+	uint64_t keys[KEY_HISTORY_LEN];
+	int len; // of the whole game, only the last KEY_HISTORY_LEN of which are kept
+} Key_History;
+
+static inline void key_history_push(Key_History *history, uint64_t key) {
+	history->keys[history->len++ & KEY_HISTORY_MASK] = key;
+}
+
+// The key of the current position, the history must not be empty
+static inline uint64_t key_history_last(const Key_History *history) {
+	return history->keys[(history->len - 1) & KEY_HISTORY_MASK];
+}
+
+static inline void key_history_pop(Key_History *history) {
+	--history->len;
+}
+
+/*
+	Whether the current position occurred times times before. Only positions since the last
+	irreversible move can match, which position->halfmove counts, and only those with the same
+	side to move, so the scan starts four plies back and steps two at a time. Pass 1 from a
+	search, where a single repetition is already as good as a draw, and 2 for threefold repetition.
+*/
+static inline bool key_history_is_repetition(const Key_History *history, const Position *position, int times) {
+	int last = history->len - 1;
+	int stop = MAX(MAX(last - position->halfmove, 0), last - KEY_HISTORY_LEN/2);
+	uint64_t key = history->keys[last & KEY_HISTORY_MASK];
+	for (int i = last - 4; i >= stop; i -= 2) {
+		if (history->keys[i & KEY_HISTORY_MASK] == key && --times == 0) return true;
+	}
+	return false;
+}
+
+// The side to move may still have been mated by the last move, which takes precedence
+static inline bool position_is_fifty_move_draw(const Position *position) {
+	return position->halfmove >= FIFTY_MOVE_PLIES;
+}
+
+#endif // REPETITION_H_
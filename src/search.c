@@ -0,0 +1,515 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <assert.h>
+
+#include "search.h"
+#include "eval.h"
+#include "termination.h"
+#include "numa.h"
+#include "see.h"
+
+_Static_assert(KEY_HISTORY_LEN/2 >= FIFTY_MOVE_PLIES + MAX_PLY, "The key history has to reach back over a whole search and the fifty-move window before it");
+
+// How many nodes go by between looking at the clock
+#define SEARCH_CHECK_NODES 1024
+#define SEARCH_PONDER_WAIT_US 1000
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+/*
+	Helper i skips depth d when (d + skip_phase[i])/skip_size[i] is odd: the first two helpers
+	take every other depth, the next four every other pair of depths and so on.
+*/
+#define SKIP_LEN 20
+static const int skip_size[SKIP_LEN]  = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+static const int skip_phase[SKIP_LEN] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
+static bool skips_depth(const Search_Thread *thread, int depth) {
+	if (thread->id == 0) return false;
+	int i = (thread->id - 1) % SKIP_LEN;
+	return (depth + skip_phase[i])/skip_size[i] % 2 != 0;
+}
+
+// A plain load and store rather than an atomic increment, since nobody else writes the count
+static uint64_t count_node(Search_Thread *thread) {
+	uint64_t nodes = atomic_load_explicit(&thread->nodes, memory_order_relaxed) + 1;
+	atomic_store_explicit(&thread->nodes, nodes, memory_order_relaxed);
+	return nodes;
+}
+
+static uint64_t search_nodes(const Search *search) {
+	uint64_t nodes = 0;
+	for (int i = 0; i < search->threads_len; ++i) nodes += atomic_load_explicit(&search->threads[i]->nodes, memory_order_relaxed);
+	return nodes;
+}
+
+// The first iteration always finishes, so that there is a move to answer with
+static bool is_stopped(const Search_Thread *thread) {
+	return thread->root_depth > 1 && atomic_load_explicit(&thread->search->stop, memory_order_relaxed);
+}
+
+// Only the main thread looks at the limits, the helpers just follow the stop flag
+static bool should_stop(Search_Thread *thread, uint64_t nodes) {
+	Search *search = thread->search;
+	if (thread->id == 0 && nodes % SEARCH_CHECK_NODES == 0 && !atomic_load_explicit(&search->pondering, memory_order_relaxed)) {
+		if (search->limits.nodes && search_nodes(search) >= search->limits.nodes) atomic_store(&search->stop, true);
+		if (search->limits.time_ms && (now() - atomic_load_explicit(&search->limits_start, memory_order_relaxed))*1000 >= search->limits.time_ms) atomic_store(&search->stop, true);
+	}
+	return is_stopped(thread);
+}
+
+static void update_pv(Search_Thread *thread, int ply, Move move) {
+	thread->pv[ply][0] = move;
+	memcpy(&thread->pv[ply][1], thread->pv[ply+1], thread->pv_len[ply+1]*sizeof(Move));
+	thread->pv_len[ply] = thread->pv_len[ply+1] + 1;
+}
+
+static Ordering_Node ordering_node(Search_Thread *thread, int ply) {
+	Ordering_Node node = {.ply = ply};
+	for (int i = 0; i < ORDERING_CONTINUATIONS; ++i) node.continuations[i] = ply > i? thread->stack[ply-1-i].continuation: NULL;
+	// There is nothing to counter after a null move
+	if (ply > 0 && thread->stack[ply-1].move != MOVE_NONE) node.countermove = &thread->ordering.countermoves[thread->stack[ply-1].piece][move_to(thread->stack[ply-1].move)];
+	return node;
+}
+
+static void push_move(Search_Thread *thread, int ply, Move move) {
+	Search_Stack *entry = &thread->stack[ply];
+	entry->move = move;
+	entry->piece = ordering_piece(thread->position.mailbox[move_from(move)]);
+	entry->continuation = &thread->ordering.continuations[entry->piece][move_to(move)];
+}
+
+// Keeps the root moves with the multipv best scores of the iteration, best first
+static void add_line(Search_Thread *thread, Move move, int score) {
+	int multipv = thread->search->limits.multipv;
+	int i = thread->lines_len < multipv? thread->lines_len++: multipv-1;
+	for (; i > 0 && thread->lines[i-1].score < score; --i) thread->lines[i] = thread->lines[i-1];
+	Search_Line *line = &thread->lines[i];
+	line->score = score;
+	line->pv[0] = move;
+	memcpy(&line->pv[1], thread->pv[1], thread->pv_len[1]*sizeof(Move));
+	line->pv_len = thread->pv_len[1] + 1;
+}
+
+// Mate scores are stored relative to the node rather than the root, so they stay right wherever the position is found again
+static int score_to_tt(int score, int ply) {
+	if (score > SCORE_MATE_BOUND) return score + ply;
+	if (score < -SCORE_MATE_BOUND) return score - ply;
+	return score;
+}
+
+static int score_from_tt(int score, int ply) {
+	if (score > SCORE_MATE_BOUND) return score - ply;
+	if (score < -SCORE_MATE_BOUND) return score + ply;
+	return score;
+}
+
+/*
+	Only captures and promotions are searched, with the static evaluation as the score when
+	standing pat, so that a line is never scored in the middle of an exchange. Captures that
+	lose material by static exchange are not searched at all, they are what makes the tree explode
+	in tactical positions and they would almost never be better than standing pat. In check there
+	is no standing pat, every evasion is tried instead.
+*/
+static int quiescence(Search_Thread *thread, int alpha, int beta, int ply) {
+	Position *position = &thread->position;
+	thread->pv_len[ply] = 0;
+	uint64_t nodes = count_node(thread);
+	if (should_stop(thread, nodes)) return 0;
+	if (ply >= MAX_PLY-1) return evaluate(position);
+
+	bool in_check = position_checkers(position) != BB_EMPTY;
+	int best_score = -SCORE_INFINITE;
+	if (!in_check) {
+		best_score = evaluate(position);
+		if (best_score >= beta) return best_score;
+		if (best_score > alpha) alpha = best_score;
+	}
+
+	Move_Picker picker;
+	if (in_check) move_picker_init(&picker, position, MOVE_NONE, NULL);
+	else move_picker_init_captures(&picker, position);
+	Move move;
+	while ((move = move_picker_next(&picker)) != MOVE_NONE) {
+		if (!in_check && !see_ge(position, move, 0)) continue;
+		Undo undo = position_make_move(position, move);
+		int score = -quiescence(thread, -beta, -alpha, ply+1);
+		position_unmake_move(position, move, undo);
+		if (is_stopped(thread)) return 0;
+
+		if (score > best_score) {
+			best_score = score;
+			if (score > alpha) {
+				alpha = score;
+				update_pv(thread, ply, move);
+				if (score >= beta) break;
+			}
+		}
+	}
+
+	if (in_check && best_score == -SCORE_INFINITE) return -SCORE_MATE + ply;
+	return best_score;
+}
+
+static int negamax(Search_Thread *thread, int depth, int alpha, int beta, int ply, bool is_pv) {
+	Position *position = &thread->position;
+	const Search_Options *options = &thread->search->options;
+	thread->pv_len[ply] = 0;
+	if (ply > 0) {
+		// One repetition is enough, whatever could be won by repeating again could have been won the first time
+		if (key_history_is_repetition(&thread->keys, position, 1) || position_is_dead(position)) return SCORE_DRAW;
+		// Being mated on the move that reaches the fifty-move limit is still a loss
+		if (position_is_fifty_move_draw(position) && (!position_checkers(position) || position_has_legal_move(position))) return SCORE_DRAW;
+		if (ply >= MAX_PLY-1) return evaluate(position);
+	}
+
+	bool in_check = position_checkers(position) != BB_EMPTY;
+	if (in_check) ++depth; // a check has few answers, so looking one further costs little
+	// Captures are never reversible, so the key history is only needed up to here
+	if (depth <= 0) return quiescence(thread, alpha, beta, ply);
+	uint64_t nodes = count_node(thread);
+	if (should_stop(thread, nodes)) return 0;
+
+	Tt *tt = &thread->search->tt;
+	Tt_Data tt_data;
+	Move hash_move = MOVE_NONE;
+	if (tt_probe(tt, position->key, &tt_data)) {
+		hash_move = tt_data.move;
+		int score = score_from_tt(tt_data.score, ply);
+		// The principal variation is always searched, so that it comes out whole
+		if (!is_pv && tt_data.depth >= depth && (tt_data.bound == TT_BOUND_EXACT
+			|| (tt_data.bound == TT_BOUND_LOWER && score >= beta)
+			|| (tt_data.bound == TT_BOUND_UPPER && score <= alpha))) return score;
+	}
+
+	// None of the pruning is done in check, where the static evaluation means little
+	int static_eval = in_check? -SCORE_INFINITE: evaluate(position);
+	bool is_prunable = !is_pv && !in_check;
+
+	if (is_prunable && options->reverse_futility && depth <= options->reverse_futility_depth
+		&& beta > -SCORE_MATE_BOUND && beta < SCORE_MATE_BOUND
+		&& static_eval - options->reverse_futility_margin*depth >= beta) return static_eval;
+
+	// Without any piece but pawns and the king, passing is often the best move there is (zugzwang)
+	Bitboard pieces = position->by_owner[position->turn] & ~position->by_type[TYPE_PAWN] & ~position->by_type[TYPE_KING];
+	if (is_prunable && options->null_move && depth >= options->null_move_depth && ply >= thread->null_move_ply
+		&& static_eval >= beta && pieces != BB_EMPTY && ply > 0 && thread->stack[ply-1].move != MOVE_NONE) {
+		int reduction = options->null_move_reduction + depth/options->null_move_divisor;
+		thread->stack[ply] = (Search_Stack){MOVE_NONE, 0, NULL};
+		Undo undo = position_make_null_move(position);
+		tt_prefetch(tt, position->key);
+		key_history_push(&thread->keys, position->key);
+		int score = -negamax(thread, depth-1-reduction, -beta, -beta+1, ply+1, false);
+		key_history_pop(&thread->keys);
+		position_unmake_null_move(position, undo);
+		if (is_stopped(thread)) return 0;
+
+		if (score >= beta) {
+			// A mate found after passing was not found against the best defence
+			if (score > SCORE_MATE_BOUND) score = beta;
+			if (depth < options->null_move_verify) return score;
+			int null_move_ply = thread->null_move_ply;
+			thread->null_move_ply = ply + 3*(depth-reduction)/4;
+			int verified = negamax(thread, depth-reduction, beta-1, beta, ply, false);
+			thread->null_move_ply = null_move_ply;
+			if (verified >= beta) return score;
+		}
+	}
+
+	Ordering_Node node = ordering_node(thread, ply);
+	Move_Picker picker;
+	move_picker_init(&picker, position, hash_move, thread->ordering.killers[ply]);
+	move_picker_use_ordering(&picker, &thread->ordering, &node);
+
+	bool is_futile = is_prunable && options->futility && depth <= options->futility_depth
+		&& static_eval + options->futility_base + options->futility_margin*depth <= alpha;
+	int late_quiets = is_prunable && options->late_move_pruning && depth <= options->late_move_pruning_depth?
+		options->late_move_pruning_base + depth*depth: MAX_MOVES;
+
+	int alpha_start = alpha, best_score = -SCORE_INFINITE, moves_searched = 0, quiets_len = 0;
+	Move move, best_move = MOVE_NONE, quiets[MAX_MOVES];
+	int multipv = thread->search->limits.multipv;
+	bool is_multipv = ply == 0 && multipv > 1;
+	if (is_multipv) thread->lines_len = 0;
+	while ((move = move_picker_next(&picker)) != MOVE_NONE) {
+		bool is_capture = position_is_capture(position, move);
+		// Only once a move has been found that does not lose to mate can the rest be skipped
+		bool may_skip = !is_capture && best_score > -SCORE_MATE_BOUND;
+		if (may_skip && quiets_len >= late_quiets) continue;
+
+		push_move(thread, ply, move);
+		Undo undo = position_make_move(position, move);
+		bool gives_check = position_checkers(position) != BB_EMPTY;
+		if (may_skip && is_futile && !gives_check) {
+			position_unmake_move(position, move, undo);
+			continue;
+		}
+		tt_prefetch(tt, position->key);
+		key_history_push(&thread->keys, position->key);
+
+		// Until there are multipv lines every root move gets an exact score, then it has to beat the last of them
+		if (is_multipv) alpha = thread->lines_len < multipv? alpha_start: thread->lines[multipv-1].score;
+		int score;
+		if (moves_searched == 0 || (is_multipv && thread->lines_len < multipv)) {
+			score = -negamax(thread, depth-1, -beta, -alpha, ply+1, is_pv);
+		} else {
+			int reduction = 0;
+			if (options->lmr && depth >= options->lmr_depth && moves_searched >= options->lmr_moves + is_pv && !is_capture && !in_check && !gives_check) {
+				reduction = thread->search->reductions[depth < MAX_PLY? depth: MAX_PLY-1][moves_searched] - is_pv;
+				reduction = reduction < 0? 0: reduction > depth-2? depth-2: reduction;
+			}
+			score = -negamax(thread, depth-1-reduction, -alpha-1, -alpha, ply+1, false);
+			if (reduction > 0 && score > alpha) score = -negamax(thread, depth-1, -alpha-1, -alpha, ply+1, false);
+			if (score > alpha && score < beta) score = -negamax(thread, depth-1, -beta, -alpha, ply+1, true);
+		}
+
+		key_history_pop(&thread->keys);
+		position_unmake_move(position, move, undo);
+		++moves_searched;
+		if (is_stopped(thread)) return 0;
+		if (is_multipv && score > alpha) add_line(thread, move, score);
+
+		if (score > best_score) {
+			best_score = score;
+			best_move = move;
+			if (score > alpha) {
+				alpha = score;
+				update_pv(thread, ply, move);
+				if (score >= beta) {
+					if (!is_capture) ordering_update_cutoff(&thread->ordering, &node, position, move, quiets, quiets_len, depth);
+					break;
+				}
+			}
+		}
+		if (!is_capture) quiets[quiets_len++] = move;
+	}
+
+	if (moves_searched == 0) return in_check? -SCORE_MATE + ply: SCORE_DRAW;
+	Tt_Bound bound = best_score >= beta? TT_BOUND_LOWER: best_score > alpha_start? TT_BOUND_EXACT: TT_BOUND_UPPER;
+	// Below alpha every move is just as bad as far as the search knows, so none of them is worth remembering
+	tt_store(tt, position->key, bound == TT_BOUND_UPPER? MOVE_NONE: best_move, score_to_tt(best_score, ply), depth, bound);
+	return best_score;
+}
+
+typedef struct {
+	const char *name;
+	size_t offset;
+	bool is_switch; // a bool rather than an int
+} Search_Option_Field;
+
+#define SEARCH_OPTION(field, is_switch) {#field, offsetof(Search_Options, field), is_switch}
+static const Search_Option_Field option_fields[] = {
+	SEARCH_OPTION(null_move, true),
+	SEARCH_OPTION(null_move_depth, false),
+	SEARCH_OPTION(null_move_reduction, false),
+	SEARCH_OPTION(null_move_divisor, false),
+	SEARCH_OPTION(null_move_verify, false),
+	SEARCH_OPTION(lmr, true),
+	SEARCH_OPTION(lmr_base, false),
+	SEARCH_OPTION(lmr_divisor, false),
+	SEARCH_OPTION(lmr_depth, false),
+	SEARCH_OPTION(lmr_moves, false),
+	SEARCH_OPTION(reverse_futility, true),
+	SEARCH_OPTION(reverse_futility_depth, false),
+	SEARCH_OPTION(reverse_futility_margin, false),
+	SEARCH_OPTION(futility, true),
+	SEARCH_OPTION(futility_depth, false),
+	SEARCH_OPTION(futility_base, false),
+	SEARCH_OPTION(futility_margin, false),
+	SEARCH_OPTION(late_move_pruning, true),
+	SEARCH_OPTION(late_move_pruning_depth, false),
+	SEARCH_OPTION(late_move_pruning_base, false),
+};
+#define OPTION_FIELDS_LEN (sizeof(option_fields)/sizeof(option_fields[0]))
+
+void search_options_default(Search_Options *options) {
+	*options = (Search_Options){
+		.null_move = true,
+		.null_move_depth = 3,
+		.null_move_reduction = 3,
+		.null_move_divisor = 4,
+		.null_move_verify = 12,
+		.lmr = true,
+		.lmr_base = 75,
+		.lmr_divisor = 225,
+		.lmr_depth = 3,
+		.lmr_moves = 2,
+		.reverse_futility = true,
+		.reverse_futility_depth = 7,
+		.reverse_futility_margin = 80,
+		.futility = true,
+		.futility_depth = 6,
+		.futility_base = 100,
+		.futility_margin = 100,
+		.late_move_pruning = true,
+		.late_move_pruning_depth = 8,
+		.late_move_pruning_base = 3,
+	};
+}
+
+bool search_option_parse(Search_Options *options, const char *name, const char *value) {
+	for (size_t i = 0; i < OPTION_FIELDS_LEN; ++i) {
+		if (strcmp(option_fields[i].name, name) != 0) continue;
+		char *field = (char *)options + option_fields[i].offset;
+		if (option_fields[i].is_switch) {
+			bool is_on = strcmp(value, "on") == 0 || strcmp(value, "1") == 0;
+			if (!is_on && strcmp(value, "off") != 0 && strcmp(value, "0") != 0) return false;
+			*(bool *)field = is_on;
+			return true;
+		}
+		char *end;
+		long number = strtol(value, &end, 10);
+		if (*value == '\0' || *end != '\0') return false;
+		*(int *)field = (int)number;
+		return true;
+	}
+	return false;
+}
+
+const char *search_option_name(int i) {
+	return i >= 0 && i < (int)OPTION_FIELDS_LEN? option_fields[i].name: NULL;
+}
+
+void search_set_options(Search *search, const Search_Options *options) {
+	search->options = *options;
+	if (search->options.null_move_divisor < 1) search->options.null_move_divisor = 1;
+	if (search->options.lmr_divisor < 1) search->options.lmr_divisor = 1;
+	for (int depth = 0; depth < MAX_PLY; ++depth) {
+		for (int moves = 0; moves < MAX_MOVES; ++moves) {
+			double reduction = depth == 0 || moves == 0? 0: search->options.lmr_base/100.0 + log(depth)*log(moves)/(search->options.lmr_divisor/100.0);
+			search->reductions[depth][moves] = reduction < 0? 0: (uint8_t)reduction;
+		}
+	}
+}
+
+void search_init(Search *search, size_t hash_mb, int threads) {
+	assert(threads >= 1 && threads <= SEARCH_MAX_THREADS);
+	memset(search, 0, sizeof(*search));
+	Search_Options options;
+	search_options_default(&options);
+	search_set_options(search, &options);
+	tt_init(&search->tt, hash_mb);
+	search->threads_len = threads;
+	for (int i = 0; i < threads; ++i) {
+		// Page aligned, so threads never share a page either, let alone a cache line
+		Search_Thread *thread = numa_alloc(sizeof(Search_Thread), i == 0? -1: i);
+		assert(thread != NULL);
+		thread->search = search;
+		thread->id = i;
+		search->threads[i] = thread;
+	}
+}
+
+void search_free(Search *search) {
+	tt_free(&search->tt);
+	for (int i = 0; i < search->threads_len; ++i) numa_free(search->threads[i], sizeof(Search_Thread));
+}
+
+// Runs one deeper iteration after another, result is only given to the main thread
+static void iterate(Search_Thread *thread, Search_Result *result) {
+	Search *search = thread->search;
+	int max_depth = search->limits.depth > 0 && search->limits.depth < MAX_PLY? search->limits.depth: MAX_PLY-1;
+	for (int depth = 1; depth <= max_depth; ++depth) {
+		if (skips_depth(thread, depth)) continue;
+		thread->root_depth = depth;
+		int score = negamax(thread, depth, -SCORE_INFINITE, SCORE_INFINITE, 0, true);
+		// An unfinished iteration may not even have looked at the best move of the one before
+		if (is_stopped(thread)) break;
+		if (result == NULL) continue;
+
+		result->depth = depth;
+		result->score = score;
+		result->pv_len = thread->pv_len[0];
+		memcpy(result->pv, thread->pv[0], result->pv_len*sizeof(Move));
+		if (result->pv_len > 0) result->best_move = result->pv[0];
+		if (search->limits.multipv > 1) {
+			result->lines_len = thread->lines_len;
+			memcpy(result->lines, thread->lines, thread->lines_len*sizeof(Search_Line));
+		} else {
+			result->lines_len = 1;
+			result->lines[0].score = score;
+			result->lines[0].pv_len = result->pv_len;
+			memcpy(result->lines[0].pv, result->pv, result->pv_len*sizeof(Move));
+		}
+		result->nodes = search_nodes(search);
+		result->seconds = now() - search->start;
+		if (search->report) search->report(result, search->report_data);
+		if (atomic_load(&search->stop)) break;
+		// A mate that has been found will not get any shorter by looking deeper, though the other lines might still change
+		if (search->limits.multipv <= 1 && (score > SCORE_MATE_BOUND || score < -SCORE_MATE_BOUND)) break;
+	}
+}
+
+static void *helper_main(void *data) {
+	Search_Thread *thread = data;
+	numa_bind_thread(thread->id);
+	iterate(thread, NULL);
+	return NULL;
+}
+
+Search_Result search_run(Search *search, const Position *position, const Key_History *history, Search_Limits limits) {
+	if (limits.multipv < 1) limits.multipv = 1;
+	if (limits.multipv > SEARCH_MAX_LINES) limits.multipv = SEARCH_MAX_LINES;
+	search->limits = limits;
+	search->start = now();
+	atomic_store(&search->limits_start, search->start);
+	atomic_store(&search->pondering, limits.ponder);
+	atomic_store(&search->stop, false);
+	tt_new_search(&search->tt);
+
+	Search_Result result = {0};
+	Move_List moves;
+	generate_legal(position, &moves);
+	if (moves.len == 0) {
+		result.score = position_checkers(position)? -SCORE_MATE: SCORE_DRAW;
+		return result;
+	}
+	result.best_move = moves.moves[0];
+
+	for (int i = 0; i < search->threads_len; ++i) {
+		Search_Thread *thread = search->threads[i];
+		thread->position = *position;
+		thread->keys.len = 0;
+		if (history) thread->keys = *history;
+		if (thread->keys.len == 0 || key_history_last(&thread->keys) != position->key) key_history_push(&thread->keys, position->key);
+		atomic_store(&thread->nodes, 0);
+		thread->root_depth = 0;
+		thread->null_move_ply = 0;
+		ordering_new_search(&thread->ordering);
+	}
+	for (int i = 1; i < search->threads_len; ++i) pthread_create(&search->threads[i]->handle, NULL, helper_main, search->threads[i]);
+	iterate(search->threads[0], &result);
+	// A search that has run out of depth before the opponent moved has to wait for it all the same
+	while (atomic_load(&search->pondering) && !atomic_load(&search->stop)) usleep(SEARCH_PONDER_WAIT_US);
+	atomic_store(&search->stop, true);
+	for (int i = 1; i < search->threads_len; ++i) pthread_join(search->threads[i]->handle, NULL);
+
+	result.nodes = search_nodes(search);
+	result.seconds = now() - search->start;
+	return result;
+}
+
+void search_stop(Search *search) {
+	atomic_store(&search->stop, true);
+}
+
+void search_ponderhit(Search *search) {
+	if (!atomic_load(&search->pondering)) return;
+	atomic_store(&search->limits_start, now());
+	atomic_store(&search->pondering, false);
+}
+
+void score_name(int score, char *text) {
+	if (score > SCORE_MATE_BOUND) snprintf(text, SCORE_NAME_LEN, "mate %d", (SCORE_MATE - score + 1)/2);
+	else if (score < -SCORE_MATE_BOUND) snprintf(text, SCORE_NAME_LEN, "mate %d", -(SCORE_MATE + score)/2);
+	else snprintf(text, SCORE_NAME_LEN, "cp %d", score);
+}
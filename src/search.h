@@ -0,0 +1,166 @@
+#ifndef SEARCH_H_
+#define SEARCH_H_
+
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "movegen.h"
+#include "movepick.h"
+#include "repetition.h"
+#include "tt.h"
+#include "pool.h"
+
+#define SEARCH_MAX_THREADS POOL_MAX_WORKERS
+#define SEARCH_MAX_LINES 8
+
+#define SCORE_INFINITE 32000
+#define SCORE_MATE 31000 // mate on the board, SCORE_MATE - n is mate in n plies
+#define SCORE_MATE_BOUND (SCORE_MATE - MAX_PLY) // anything beyond this is a mate score
+#define SCORE_DRAW 0
+
+// Anything left at 0 is unlimited, a search without any limit runs to MAX_PLY or until search_stop
+typedef struct {
+	int depth;
+	uint64_t nodes;
+	int64_t time_ms;
+	// On the opponent's time: the limits do not count, nor does the search return, until search_ponderhit
+	bool ponder;
+	int multipv; // how many of the best root moves get an exact score and a line, up to SEARCH_MAX_LINES, 0 is 1
+} Search_Limits;
+
+/*
+	The forward pruning the search does, each with a switch and the numbers it depends on, so that
+	what one buys can be measured by turning it off. Depths are in plies and margins in centipawns.
+*/
+typedef struct {
+	// Passing the turn and still failing high with a reduced search means the node is not worth searching
+	bool null_move;
+	int null_move_depth; // from this depth on
+	int null_move_reduction; // the null move is searched null_move_reduction + depth/null_move_divisor plies shallower
+	int null_move_divisor;
+	int null_move_verify; // from this depth on a cutoff is only trusted after a search without null moves agrees, for zugzwang
+	// Late moves are searched shallower, by log(depth)*log(moves)/divisor + base, and again at full depth if they beat alpha
+	bool lmr;
+	int lmr_base; // in hundredths
+	int lmr_divisor; // in hundredths
+	int lmr_depth;
+	int lmr_moves; // moves searched before any is reduced, one more at PV nodes
+	// A static evaluation this far above beta near the leaves is trusted to hold
+	bool reverse_futility;
+	int reverse_futility_depth;
+	int reverse_futility_margin; // per ply
+	// Quiet moves are skipped near the leaves when even a generous gain would not reach alpha
+	bool futility;
+	int futility_depth;
+	int futility_base;
+	int futility_margin; // per ply
+	// Only the first late_move_pruning_base + depth*depth quiet moves are searched near the leaves
+	bool late_move_pruning;
+	int late_move_pruning_depth;
+	int late_move_pruning_base;
+} Search_Options;
+
+// One root move with its score and the line that follows it
+typedef struct {
+	int score;
+	Move pv[MAX_PLY]; // starting with the root move
+	int pv_len;
+} Search_Line;
+
+typedef struct {
+	Move best_move; // MOVE_NONE if the position has no legal move
+	int score; // from the point of view of the side to move
+	int depth; // of the last iteration that finished
+	uint64_t nodes;
+	double seconds;
+	Move pv[MAX_PLY];
+	int pv_len;
+	// The best lines, best first, as many as multipv asked for and there are legal moves, the first is pv
+	Search_Line lines[SEARCH_MAX_LINES];
+	int lines_len;
+} Search_Result;
+
+typedef struct Search Search;
+
+// The move made at a ply, as the nodes below it index the move-ordering tables by it
+typedef struct {
+	Move move;
+	uint8_t piece; // ordering_piece of the piece that made it
+	Piece_To_History *continuation; // the table of the moves that follow it
+} Search_Stack;
+
+// Everything a single searching thread changes as it goes, aligned so that no two threads write to the same cache line
+typedef struct {
+	_Alignas(CACHE_LINE) Search *search;
+	int id; // 0 is the thread that called search_run
+	pthread_t handle;
+	Position position;
+	Key_History keys;
+	_Atomic uint64_t nodes; // only written by the thread itself
+	int root_depth;
+	int null_move_ply; // null moves are only tried from this ply on, to verify a null-move cutoff without them
+	Search_Stack stack[MAX_PLY];
+	Ordering ordering;
+	Move pv[MAX_PLY][MAX_PLY]; // pv[ply] is the best line found from ply on, pv_len[ply] moves long
+	int pv_len[MAX_PLY];
+	Search_Line lines[SEARCH_MAX_LINES]; // the best root moves of the current iteration so far, for multipv
+	int lines_len;
+} Search_Thread;
+
+/*
+	Negamax alpha-beta with principal variation search: the first move of a node is searched with
+	the full window, every other one only has to be shown to be worse with a null window, and is
+	searched again properly when that fails. Iterative deepening runs it one ply deeper at a time,
+	so that whenever a limit is hit there is a finished iteration to answer with, and the line
+	found by the last one is tried first in the next, by way of the transposition table. The table
+	outlives a search, so that the next one starts from everything this one found.
+
+	More threads run the same iterative deepening on their own copy of everything but the table
+	(Lazy SMP). They only help each other through the entries they leave in it, and the helpers skip
+	some depths, depending on their id, so that they spread out over the next few iterations instead
+	of all searching the same tree in the same order. The thread that called search_run decides when
+	the search is over and its result is the one returned. Helper i is pinned to the NUMA node of i,
+	with its Search_Thread allocated there, the calling thread is left where it is.
+
+	With multipv, the root keeps the best few lines of the iteration so far, and any other root move
+	only has to be shown to be worse than the last of them. All the lines come out of the one search
+	of the root, rather than a search each with the moves before it left out.
+*/
+struct Search {
+	Search_Limits limits;
+	Search_Options options;
+	uint8_t reductions[MAX_PLY][MAX_MOVES]; // of late moves by depth and moves searched, worked out from options
+	_Alignas(CACHE_LINE) _Atomic bool stop;
+	_Atomic bool pondering;
+	double start;
+	_Atomic double limits_start; // when the limits started to count, later than start after a ponder hit
+	// Called after every finished iteration, may be NULL
+	void (*report)(const Search_Result *result, void *data);
+	void *report_data;
+	Tt tt;
+	Search_Thread *threads[SEARCH_MAX_THREADS];
+	int threads_len;
+};
+
+// threads is at most SEARCH_MAX_THREADS
+void search_init(Search *search, size_t hash_mb, int threads);
+void search_free(Search *search);
+void search_options_default(Search_Options *options);
+// Takes effect from the next search_run, not to be called while one is running
+void search_set_options(Search *search, const Search_Options *options);
+// Sets an option by the name of its field, value is "on", "off" or a number, returns false if either is unknown
+bool search_option_parse(Search_Options *options, const char *name, const char *value);
+// The name of the i-th option, NULL past the last one
+const char *search_option_name(int i);
+// history holds the keys of the game so far, ending with position's, and may be NULL
+Search_Result search_run(Search *search, const Position *position, const Key_History *history, Search_Limits limits);
+// Makes a search_run in progress on another thread return as soon as possible
+void search_stop(Search *search);
+// The opponent played the move being pondered on: the search goes on as a normal one, its limits counting from now
+void search_ponderhit(Search *search);
+
+#define SCORE_NAME_LEN 24
+// Writes score as "cp 35" or "mate 3" (in moves, negative when being mated) into text, which needs room for SCORE_NAME_LEN characters
+void score_name(int score, char *text);
+
+#endif // SEARCH_H_
@@ -0,0 +1,56 @@
+#include "see.h"
+#include "eval.h"
+#include "attacks.h"
+
+// Cheapest first, the order the exchange is played in
+static const Piece_Type see_order[] = {TYPE_PAWN, TYPE_KNIGHT, TYPE_BISHOP, TYPE_ROOK, TYPE_QUEEN, TYPE_KING};
+
+bool see_ge(const Position *position, Move move, int threshold) {
+	if (move_kind(move) == MOVE_CASTLING) return 0 >= threshold;
+
+	Square from = move_from(move), to = move_to(move);
+	Piece_Type mover = PIECE_PACKED_TYPE(position->mailbox[from]);
+	Bitboard occupied = position->occupied ^ BB_SQUARE(from);
+	int gain = piece_values[PIECE_PACKED_TYPE(position->mailbox[to])];
+	if (move_kind(move) == MOVE_EN_PASSANT) {
+		gain = VALUE_PAWN;
+		occupied ^= BB_SQUARE(SQUARE(SQUARE_ROW(from), SQUARE_COL(to)));
+	} else if (move_kind(move) == MOVE_PROMOTION) {
+		mover = move_promotion(move);
+		gain += piece_values[mover] - VALUE_PAWN;
+	}
+
+	// swap is how far above the threshold the side that just captured is, if the exchange stopped now
+	int swap = gain - threshold;
+	if (swap < 0) return false;
+	// And this is how far it would be below it if the piece that just captured were taken back for free
+	swap = piece_values[mover] - swap;
+	if (swap <= 0) return true;
+
+	occupied |= BB_SQUARE(to);
+	Bitboard rooks = position->by_type[TYPE_ROOK] | position->by_type[TYPE_QUEEN];
+	Bitboard bishops = position->by_type[TYPE_BISHOP] | position->by_type[TYPE_QUEEN];
+	Bitboard attackers = position_attackers(position, to, occupied);
+	Piece_Owner side = position->turn;
+	bool result = true;
+	for (;;) {
+		side = owner_next(side);
+		attackers &= occupied;
+		Bitboard ours = attackers & position->by_owner[side];
+		if (ours == BB_EMPTY) break;
+		result = !result;
+
+		int i = 0;
+		while (!(ours & position->by_type[see_order[i]])) ++i;
+		Piece_Type type = see_order[i];
+		// The king can only take last, when the other side has nothing left to take it with
+		if (type == TYPE_KING) return (attackers & position->by_owner[owner_next(side)]) != BB_EMPTY? !result: result;
+
+		swap = piece_values[type] - swap;
+		if (swap < (int)result) break;
+		occupied ^= BB_SQUARE(bb_first(ours & position->by_type[type]));
+		if (type == TYPE_PAWN || type == TYPE_BISHOP || type == TYPE_QUEEN) attackers |= attacks_bishop(to, occupied) & bishops;
+		if (type == TYPE_ROOK || type == TYPE_QUEEN) attackers |= attacks_rook(to, occupied) & rooks;
+	}
+	return result;
+}
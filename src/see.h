@@ -0,0 +1,15 @@
+#ifndef SEE_H_
+#define SEE_H_
+
+#include "movegen.h"
+
+/*
+	Static exchange evaluation: whether playing move and then recapturing on its target square,
+	each side always with its least valuable piece and free to stop whenever carrying on would
+	lose material, gains at least threshold centipawns. Sliders that were behind a piece which
+	has taken part join in as it leaves, since their attacks stop at the first occupied square and
+	simply reach further once it is gone. Pins are not taken into account.
+*/
+bool see_ge(const Position *position, Move move, int threshold);
+
+#endif // SEE_H_
@@ -0,0 +1,30 @@
+#include <assert.h>
+#include <string.h>
+
+#include "spsc.h"
+
+void spsc_init(Spsc *queue, void *items, size_t item_size, size_t capacity) {
+	assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+	atomic_init(&queue->head, 0);
+	atomic_init(&queue->tail, 0);
+	queue->items = items;
+	queue->item_size = item_size;
+	queue->capacity = capacity;
+}
+
+bool spsc_push(Spsc *queue, const void *item) {
+	size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+	// Acquire, so the consumer is done copying out of the slot before it is written again
+	if (head - atomic_load_explicit(&queue->tail, memory_order_acquire) == queue->capacity) return false;
+	memcpy(queue->items + (head & (queue->capacity - 1))*queue->item_size, item, queue->item_size);
+	atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+	return true;
+}
+
+bool spsc_pop(Spsc *queue, void *item) {
+	size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+	if (atomic_load_explicit(&queue->head, memory_order_acquire) == tail) return false;
+	memcpy(item, queue->items + (tail & (queue->capacity - 1))*queue->item_size, queue->item_size);
+	atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+	return true;
+}
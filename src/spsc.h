@@ -0,0 +1,34 @@
+#ifndef SPSC_H_
+#define SPSC_H_
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "pool.h"
+
+/*
+	A bounded queue between exactly one producer thread and one consumer thread, without locks.
+	Items are copied in and out whole, into storage the owner provides. Only the producer stores
+	head and only the consumer stores tail, and each sits on its own cache line, so the two sides
+	only ever touch each other's line to find out whether the queue is full or empty.
+*/
+typedef struct {
+	_Alignas(CACHE_LINE) _Atomic size_t head; // the number of items ever pushed
+	_Alignas(CACHE_LINE) _Atomic size_t tail; // the number of items ever popped
+	_Alignas(CACHE_LINE) unsigned char *items;
+	size_t item_size;
+	size_t capacity; // a power of two
+} Spsc;
+
+void spsc_init(Spsc *queue, void *items, size_t item_size, size_t capacity);
+// Only from the producer, false and nothing copied if the queue is full
+bool spsc_push(Spsc *queue, const void *item);
+// Only from the consumer, false and nothing copied if the queue is empty
+bool spsc_pop(Spsc *queue, void *item);
+
+static inline bool spsc_is_empty(Spsc *queue) {
+	return atomic_load_explicit(&queue->head, memory_order_acquire) == atomic_load_explicit(&queue->tail, memory_order_acquire);
+}
+
+#endif // SPSC_H_
@@ -0,0 +1,63 @@
+#include "termination.h"
+#include "movegen.h"
+
+typedef enum {
+	MATERIAL_SUFFICIENT,
+	MATERIAL_DEAD,
+	MATERIAL_DEAD_IF_SAME_COLOUR_BISHOPS
+} Material_Class;
+
+/*
+	Once only kings, knights and bishops are left, the counts of knights and bishops on each side,
+	capped at 3, make up a signature that picks the class out of a table, instead of going through
+	the cases every time.
+*/
+#define MATERIAL_SIGNATURES 256
+static uint8_t material_classes[MATERIAL_SIGNATURES];
+static Bitboard dark_squares;
+
+static int capped(Bitboard bb) {
+	int count = bb_count(bb);
+	return count < 3? count: 3;
+}
+
+static int material_signature(const Position *position) {
+	Bitboard knights = position->by_type[TYPE_KNIGHT], bishops = position->by_type[TYPE_BISHOP];
+	Bitboard white = position->by_owner[OWNER_WHITE], black = position->by_owner[OWNER_BLACK];
+	return capped(knights & white) | capped(bishops & white) << 2 | capped(knights & black) << 4 | capped(bishops & black) << 6;
+}
+
+void termination_init(void) {
+	for (int signature = 0; signature < MATERIAL_SIGNATURES; ++signature) {
+		int knights = (signature & 3) + (signature >> 4 & 3);
+		int bishops = (signature >> 2 & 3) + (signature >> 6 & 3);
+		if (knights == 0) material_classes[signature] = MATERIAL_DEAD_IF_SAME_COLOUR_BISHOPS; // including no bishops at all
+		else if (knights == 1 && bishops == 0) material_classes[signature] = MATERIAL_DEAD;
+		else material_classes[signature] = MATERIAL_SUFFICIENT;
+	}
+	dark_squares = BB_EMPTY;
+	for (Square sq = 0; sq < BOARD_LEN; ++sq) {
+		if ((SQUARE_ROW(sq) + SQUARE_COL(sq)) % 2 == 1) dark_squares |= BB_SQUARE(sq);
+	}
+}
+
+bool position_is_dead(const Position *position) {
+	if (position->by_type[TYPE_PAWN] | position->by_type[TYPE_ROOK] | position->by_type[TYPE_QUEEN]) return false;
+	switch ((Material_Class)material_classes[material_signature(position)]) {
+	case MATERIAL_SUFFICIENT: return false;
+	case MATERIAL_DEAD: return true;
+	case MATERIAL_DEAD_IF_SAME_COLOUR_BISHOPS: {
+		Bitboard bishops = position->by_type[TYPE_BISHOP];
+		return !(bishops & dark_squares) || !(bishops & ~dark_squares);
+	}
+	}
+	return false;
+}
+
+Termination position_termination(const Position *position, const Key_History *history) {
+	if (!position_has_legal_move(position)) return position_checkers(position)? TERMINATION_CHECKMATE: TERMINATION_STALEMATE;
+	if (position_is_dead(position)) return TERMINATION_INSUFFICIENT_MATERIAL;
+	if (position_is_fifty_move_draw(position)) return TERMINATION_FIFTY_MOVES;
+	if (history && key_history_is_repetition(history, position, 2)) return TERMINATION_REPETITION;
+	return TERMINATION_NONE;
+}
@@ -0,0 +1,23 @@
+#ifndef TERMINATION_H_
+#define TERMINATION_H_
+
+#include "position.h"
+#include "repetition.h"
+
+typedef enum {
+	TERMINATION_NONE,
+	TERMINATION_CHECKMATE, // position->turn has lost
+	TERMINATION_STALEMATE,
+	TERMINATION_INSUFFICIENT_MATERIAL,
+	TERMINATION_FIFTY_MOVES,
+	TERMINATION_REPETITION
+} Termination;
+
+// Has to be called once before position_termination or position_is_dead
+void termination_init(void);
+// Neither side can ever mate: K v K, a single minor piece v K, or bishops that all stand on one colour
+bool position_is_dead(const Position *position);
+// Why the game is over in position, history may be NULL to leave out threefold repetition
+Termination position_termination(const Position *position, const Key_History *history);
+
+#endif // TERMINATION_H_
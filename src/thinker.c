@@ -0,0 +1,139 @@
+#include <string.h>
+#include <unistd.h>
+
+#include "thinker.h"
+
+// Only called from the engine thread, the sole writer
+static void publish(Thinker *thinker) {
+	uint64_t words[THINKER_SNAPSHOT_WORDS] = {0};
+	memcpy(words, &thinker->snapshot, sizeof(thinker->snapshot));
+	uint32_t sequence = atomic_load_explicit(&thinker->sequence, memory_order_relaxed);
+	atomic_store_explicit(&thinker->sequence, sequence + 1, memory_order_relaxed);
+	// The odd sequence has to be visible before any of the words that follow it
+	atomic_thread_fence(memory_order_release);
+	for (size_t i = 0; i < THINKER_SNAPSHOT_WORDS; ++i) atomic_store_explicit(&thinker->snapshot_words[i], words[i], memory_order_relaxed);
+	atomic_store_explicit(&thinker->sequence, sequence + 2, memory_order_release);
+}
+
+static void snapshot_result(Thinker *thinker, const Search_Result *result) {
+	Thinker_Snapshot *snapshot = &thinker->snapshot;
+	snapshot->best_move = result->best_move;
+	snapshot->score = result->score;
+	snapshot->depth = result->depth;
+	snapshot->nodes = result->nodes;
+	snapshot->seconds = result->seconds;
+	snapshot->pv_len = result->pv_len;
+	memcpy(snapshot->pv, result->pv, result->pv_len*sizeof(Move));
+	snapshot->lines_len = result->lines_len;
+	memcpy(snapshot->lines, result->lines, result->lines_len*sizeof(Search_Line));
+}
+
+static void report(const Search_Result *result, void *data) {
+	Thinker *thinker = data;
+	snapshot_result(thinker, result);
+	thinker->snapshot.is_pondering = atomic_load(&thinker->search.pondering);
+	publish(thinker);
+}
+
+static void go(Thinker *thinker) {
+	Thinker_Command *command = &thinker->command;
+	atomic_store(&thinker->searching_id, command->id);
+	thinker->snapshot = (Thinker_Snapshot){.id = command->id, .is_searching = true, .is_pondering = command->limits.ponder};
+	publish(thinker);
+
+	Search_Result result = search_run(&thinker->search, &command->position, &command->keys, command->limits);
+	atomic_store(&thinker->searching_id, 0);
+	snapshot_result(thinker, &result);
+	thinker->snapshot.is_searching = false;
+	thinker->snapshot.is_pondering = false;
+	publish(thinker);
+	// Whoever sent a later command has moved on, and a result nobody collects any more is dropped
+	if (spsc_is_empty(&thinker->commands)) spsc_push(&thinker->results, &(Thinker_Result){command->id, result});
+}
+
+static void *thinker_main(void *data) {
+	Thinker *thinker = data;
+	for (;;) {
+		if (!spsc_pop(&thinker->commands, &thinker->command)) {
+			usleep(THINKER_IDLE_US);
+			continue;
+		}
+		if (thinker->command.kind == THINKER_QUIT) break;
+		// A go that is already followed by another command would only be stopped as soon as it started
+		if (thinker->command.kind == THINKER_GO && spsc_is_empty(&thinker->commands)) go(thinker);
+	}
+	return NULL;
+}
+
+void thinker_start(Thinker *thinker, size_t hash_mb, int threads) {
+	memset(thinker, 0, sizeof(*thinker));
+	search_init(&thinker->search, hash_mb, threads);
+	thinker->search.report = report;
+	thinker->search.report_data = thinker;
+	spsc_init(&thinker->commands, thinker->command_items, sizeof(Thinker_Command), THINKER_QUEUE_LEN);
+	spsc_init(&thinker->results, thinker->result_items, sizeof(Thinker_Result), THINKER_QUEUE_LEN);
+	pthread_create(&thinker->handle, NULL, thinker_main, thinker);
+}
+
+static uint32_t send(Thinker *thinker, Thinker_Command_Kind kind) {
+	Thinker_Command *command = &thinker->outgoing;
+	command->kind = kind;
+	command->id = thinker->last_id + 1;
+	if (!spsc_push(&thinker->commands, command)) return 0;
+	thinker->last_id = command->id;
+	search_stop(&thinker->search);
+	return command->id;
+}
+
+void thinker_quit(Thinker *thinker) {
+	// Unlike the other commands, this one cannot be dropped for want of room
+	while (send(thinker, THINKER_QUIT) == 0) usleep(THINKER_IDLE_US);
+	pthread_join(thinker->handle, NULL);
+	search_free(&thinker->search);
+}
+
+uint32_t thinker_go(Thinker *thinker, const Position *position, const Key_History *keys, Search_Limits limits) {
+	Thinker_Command *command = &thinker->outgoing;
+	command->position = *position;
+	command->keys.len = 0;
+	if (keys) command->keys = *keys;
+	command->limits = limits;
+	return send(thinker, THINKER_GO);
+}
+
+void thinker_stop(Thinker *thinker) {
+	send(thinker, THINKER_STOP);
+}
+
+void thinker_ponderhit(Thinker *thinker, uint32_t id) {
+	// Not a command, which would stop the very search it is about
+	thinker->ponderhit_id = id;
+	search_ponderhit(&thinker->search);
+}
+
+bool thinker_result(Thinker *thinker, Thinker_Result *result) {
+	/*
+		search_run clears the stop flag when it starts, so a command sent just before a go got
+		that far does not stop it. Until the engine catches up with the last command, keep asking.
+		The same goes for a ponder hit, which search_run would turn back into pondering.
+	*/
+	uint32_t searching_id = atomic_load(&thinker->searching_id);
+	if (searching_id != 0 && searching_id != thinker->last_id) search_stop(&thinker->search);
+	if (searching_id != 0 && searching_id == thinker->ponderhit_id) search_ponderhit(&thinker->search);
+	return spsc_pop(&thinker->results, result);
+}
+
+bool thinker_snapshot(Thinker *thinker, Thinker_Snapshot *snapshot) {
+	uint64_t words[THINKER_SNAPSHOT_WORDS];
+	for (int attempt = 0; attempt < THINKER_SNAPSHOT_ATTEMPTS; ++attempt) {
+		uint32_t sequence = atomic_load_explicit(&thinker->sequence, memory_order_acquire);
+		if (sequence % 2 == 1) continue;
+		for (size_t i = 0; i < THINKER_SNAPSHOT_WORDS; ++i) words[i] = atomic_load_explicit(&thinker->snapshot_words[i], memory_order_relaxed);
+		// The words have to be read before the sequence is looked at again
+		atomic_thread_fence(memory_order_acquire);
+		if (atomic_load_explicit(&thinker->sequence, memory_order_relaxed) != sequence) continue;
+		memcpy(snapshot, words, sizeof(*snapshot));
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,98 @@
+#ifndef THINKER_H_
+#define THINKER_H_
+
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "search.h"
+#include "spsc.h"
+
+#define THINKER_QUEUE_LEN 8
+#define THINKER_IDLE_US 1000 // how long the engine thread sleeps between looks at an empty queue
+#define THINKER_SNAPSHOT_ATTEMPTS 4 // reads of a snapshot that keep being torn by a write before giving up for now
+
+typedef enum {
+	THINKER_GO,
+	THINKER_STOP, // drops the search in progress and any go still waiting, without a result
+	THINKER_QUIT,
+} Thinker_Command_Kind;
+
+typedef struct {
+	Thinker_Command_Kind kind;
+	uint32_t id;
+	Position position;
+	Key_History keys; // the game so far, ending with position's key
+	Search_Limits limits;
+} Thinker_Command;
+
+// What a go ended with, only for searches that were not stopped by a later command
+typedef struct {
+	uint32_t id; // of the go
+	Search_Result result;
+} Thinker_Result;
+
+// The latest the engine has to show, from the last finished iteration
+typedef struct {
+	uint32_t id; // of the go being searched or last searched, 0 before the first
+	bool is_searching;
+	bool is_pondering; // searching on the opponent's time, still waiting for thinker_ponderhit
+	Move best_move;
+	int score;
+	int depth;
+	uint64_t nodes;
+	double seconds;
+	int pv_len;
+	Move pv[MAX_PLY];
+	int lines_len; // with multipv, the best lines of the last iteration
+	Search_Line lines[SEARCH_MAX_LINES];
+} Thinker_Snapshot;
+
+#define THINKER_SNAPSHOT_WORDS ((sizeof(Thinker_Snapshot) + sizeof(uint64_t) - 1)/sizeof(uint64_t))
+
+/*
+	Runs the search on a thread of its own, so that whoever drives it, the UI in particular, never
+	waits for it. Commands go to the engine thread and results come back through a single-producer,
+	single-consumer queue each way. On top of that the engine publishes a snapshot of the search
+	after every iteration behind a sequence lock: the sequence is odd while a snapshot is being
+	written, and a reader that sees it odd, or changed by the time it has copied the snapshot,
+	tries again a few times and then keeps what it had, rather than ever waiting on the engine.
+
+	Every function here is for the thread that started the thinker only. A command also stops the
+	search in progress straight away, as whatever it asks for supersedes it.
+*/
+typedef struct {
+	Search search;
+	pthread_t handle;
+	Spsc commands;
+	Spsc results;
+	Thinker_Command command_items[THINKER_QUEUE_LEN];
+	Thinker_Result result_items[THINKER_QUEUE_LEN];
+	// Only the thread that started it
+	uint32_t last_id; // of the last command sent
+	uint32_t ponderhit_id; // of the last go that was pondering until thinker_ponderhit
+	Thinker_Command outgoing; // built here rather than on the stack, it is big
+	// Only the engine thread
+	Thinker_Command command; // the one being carried out
+	Thinker_Snapshot snapshot;
+	// Shared
+	_Alignas(CACHE_LINE) _Atomic uint32_t searching_id; // of the go being searched, 0 while idle
+	_Alignas(CACHE_LINE) _Atomic uint32_t sequence;
+	_Atomic uint64_t snapshot_words[THINKER_SNAPSHOT_WORDS];
+} Thinker;
+
+// threads are the search threads, including the engine thread itself
+void thinker_start(Thinker *thinker, size_t hash_mb, int threads);
+// Stops any search and waits for the engine thread to finish
+void thinker_quit(Thinker *thinker);
+
+// Searches position, keys may be NULL. Returns the id its result and snapshots will carry, 0 if the queue is full
+uint32_t thinker_go(Thinker *thinker, const Position *position, const Key_History *keys, Search_Limits limits);
+void thinker_stop(Thinker *thinker);
+// The opponent played into the position of the ponder go id, which becomes the real search without starting over
+void thinker_ponderhit(Thinker *thinker, uint32_t id);
+// Takes the next result there is, to be called every frame or so
+bool thinker_result(Thinker *thinker, Thinker_Result *result);
+// Copies the latest snapshot, false if it was being written every time it was looked at
+bool thinker_snapshot(Thinker *thinker, Thinker_Snapshot *snapshot);
+
+#endif // THINKER_H_
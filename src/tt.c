@@ -0,0 +1,144 @@
+#include <string.h>
+#include <assert.h>
+#include <sys/mman.h>
+
+#include "tt.h"
+
+#define TT_HUGE_PAGE_SIZE ((size_t)2 << 20)
+// Sampling the first thousand entries is enough to tell how full the table is
+#define TT_HASHFULL_BUCKETS (1000/TT_BUCKET_ENTRIES)
+
+static uint64_t entry_pack(Move move, int score, int depth, Tt_Bound bound, uint8_t generation) {
+	return (uint64_t)move
+		| (uint64_t)(uint16_t)score << 32
+		| (uint64_t)(uint8_t)(depth + TT_DEPTH_OFFSET) << 48
+		| (uint64_t)bound << 56
+		| (uint64_t)generation << 58;
+}
+
+static Move entry_move(uint64_t data)          { return (Move)(uint32_t)data; }
+static int entry_score(uint64_t data)          { return (int16_t)(data >> 32); }
+static int entry_depth(uint64_t data)          { return (int)((data >> 48) & 0xFF) - TT_DEPTH_OFFSET; }
+static Tt_Bound entry_bound(uint64_t data)     { return (Tt_Bound)((data >> 56) & 3); }
+static uint8_t entry_generation(uint64_t data) { return (uint8_t)(data >> 58); }
+
+static void *map_memory(size_t size, int flags) {
+	void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+	return memory == MAP_FAILED? NULL: memory;
+}
+
+/*
+	A table of tens of gigabytes touches a new 4KB page on nearly every probe, so without huge
+	pages most of the time goes into TLB misses. Explicit huge pages are tried first, they only
+	exist if the administrator reserved some. Otherwise the table is aligned to a huge page and
+	the kernel is asked to back it with transparent huge pages. The pages are only touched, and so
+	zeroed, by the first probe or store that lands in them.
+*/
+void tt_init(Tt *tt, size_t size_mb) {
+	memset(tt, 0, sizeof(*tt));
+	size_t buckets_len = 1;
+	while (2*buckets_len*sizeof(Tt_Bucket) <= size_mb << 20) buckets_len *= 2;
+	size_t size = buckets_len*sizeof(Tt_Bucket);
+	tt->mask = buckets_len - 1;
+
+#ifdef MAP_HUGETLB
+	if (size >= TT_HUGE_PAGE_SIZE) {
+		tt->memory = map_memory(size, MAP_HUGETLB);
+		tt->memory_size = size;
+		tt->buckets = tt->memory;
+		tt->pages = TT_PAGES_HUGE;
+	}
+#endif
+	if (tt->memory == NULL) {
+		size_t slack = size >= TT_HUGE_PAGE_SIZE? TT_HUGE_PAGE_SIZE: 0;
+		tt->memory = map_memory(size + slack, 0);
+		assert(tt->memory != NULL);
+		tt->memory_size = size + slack;
+		uintptr_t start = (uintptr_t)tt->memory;
+		if (slack) start = (start + slack - 1) & ~(uintptr_t)(slack - 1);
+		tt->buckets = (Tt_Bucket *)start;
+		tt->pages = TT_PAGES_NORMAL;
+#ifdef MADV_HUGEPAGE
+		if (slack && madvise(tt->buckets, size, MADV_HUGEPAGE) == 0) tt->pages = TT_PAGES_TRANSPARENT;
+#endif
+	}
+}
+
+void tt_free(Tt *tt) {
+	if (tt->memory) munmap(tt->memory, tt->memory_size);
+	memset(tt, 0, sizeof(*tt));
+}
+
+void tt_clear(Tt *tt) {
+	memset(tt->buckets, 0, tt_size(tt));
+	tt->generation = 0;
+}
+
+void tt_new_search(Tt *tt) {
+	tt->generation = (tt->generation + 1) % TT_GENERATIONS;
+}
+
+bool tt_probe(const Tt *tt, uint64_t key, Tt_Data *data) {
+	Tt_Bucket *bucket = tt_bucket(tt, key);
+	for (int i = 0; i < TT_BUCKET_ENTRIES; ++i) {
+		Tt_Entry *entry = &bucket->entries[i];
+		uint64_t entry_data = atomic_load_explicit(&entry->data, memory_order_relaxed);
+		uint64_t check = atomic_load_explicit(&entry->check, memory_order_relaxed);
+		if ((check ^ entry_data) != key || entry_bound(entry_data) == TT_BOUND_NONE) continue;
+		data->move = entry_move(entry_data);
+		data->score = entry_score(entry_data);
+		data->depth = entry_depth(entry_data);
+		data->bound = entry_bound(entry_data);
+		return true;
+	}
+	return false;
+}
+
+/*
+	An entry for the same position is always reused. Otherwise the entry given up is the one
+	worth least, where every search that went by since it was written counts against its depth.
+*/
+void tt_store(Tt *tt, uint64_t key, Move move, int score, int depth, Tt_Bound bound) {
+	Tt_Bucket *bucket = tt_bucket(tt, key);
+	Tt_Entry *replace = NULL;
+	uint64_t same_data = 0;
+	int replace_worth = 0;
+	for (int i = 0; i < TT_BUCKET_ENTRIES; ++i) {
+		Tt_Entry *entry = &bucket->entries[i];
+		uint64_t data = atomic_load_explicit(&entry->data, memory_order_relaxed);
+		uint64_t check = atomic_load_explicit(&entry->check, memory_order_relaxed);
+		if ((check ^ data) == key && entry_bound(data) != TT_BOUND_NONE) {
+			replace = entry;
+			same_data = data;
+			break;
+		}
+		int age = (tt->generation - entry_generation(data) + TT_GENERATIONS) % TT_GENERATIONS;
+		int worth = entry_bound(data) == TT_BOUND_NONE? -1000: entry_depth(data) - 4*age;
+		if (replace == NULL || worth < replace_worth) {
+			replace = entry;
+			replace_worth = worth;
+		}
+	}
+
+	if (same_data) {
+		if (move == MOVE_NONE) move = entry_move(same_data);
+		// A deeper result from this same search is worth more than a shallower bound
+		if (bound != TT_BOUND_EXACT && entry_generation(same_data) == tt->generation && depth + 4 <= entry_depth(same_data)) return;
+	}
+
+	uint64_t data = entry_pack(move, score, depth, bound, tt->generation);
+	atomic_store_explicit(&replace->check, key ^ data, memory_order_relaxed);
+	atomic_store_explicit(&replace->data, data, memory_order_relaxed);
+}
+
+int tt_hashfull(const Tt *tt) {
+	size_t buckets_len = tt->mask + 1 < TT_HASHFULL_BUCKETS? tt->mask + 1: TT_HASHFULL_BUCKETS;
+	int used = 0;
+	for (size_t i = 0; i < buckets_len; ++i) {
+		for (int j = 0; j < TT_BUCKET_ENTRIES; ++j) {
+			uint64_t data = atomic_load_explicit(&tt->buckets[i].entries[j].data, memory_order_relaxed);
+			used += entry_bound(data) != TT_BOUND_NONE && entry_generation(data) == tt->generation;
+		}
+	}
+	return used*1000/(int)(buckets_len*TT_BUCKET_ENTRIES);
+}
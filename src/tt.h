@@ -0,0 +1,85 @@
+#ifndef TT_H_
+#define TT_H_
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include "movegen.h"
+
+#define TT_BUCKET_ENTRIES 4
+#define TT_BUCKET_SIZE 64 // a cache line, so that a probe costs a single miss
+#define TT_DEPTH_OFFSET 8 // stored depths may go a little below 0, for quiescence search
+#define TT_GENERATIONS 64
+
+typedef enum {
+	TT_BOUND_NONE,
+	TT_BOUND_UPPER, // the score is at most this, no move beat alpha
+	TT_BOUND_LOWER, // the score is at least this, the move failed high
+	TT_BOUND_EXACT,
+} Tt_Bound;
+
+/*
+	16 bytes: the data packs the move (bits 0-31), the score (32-47), the depth (48-55), the bound
+	(56-57) and the generation of the search that wrote it (58-63). Entries are shared between
+	threads without locks, so check holds the key xor'd with the data: a reader that sees halves
+	written by two different stores fails the key comparison rather than using a mix of them.
+*/
+typedef struct {
+	_Atomic uint64_t check;
+	_Atomic uint64_t data;
+} Tt_Entry;
+
+typedef struct {
+	_Alignas(TT_BUCKET_SIZE) Tt_Entry entries[TT_BUCKET_ENTRIES];
+} Tt_Bucket;
+
+_Static_assert(sizeof(Tt_Bucket) == TT_BUCKET_SIZE, "A bucket should fill exactly one cache line");
+
+typedef enum {
+	TT_PAGES_NORMAL,
+	TT_PAGES_TRANSPARENT, // the kernel was asked to back the table with huge pages where it can
+	TT_PAGES_HUGE, // explicitly allocated from the huge page pool
+} Tt_Pages;
+
+typedef struct {
+	Tt_Bucket *buckets;
+	size_t mask; // buckets_len - 1, the length is a power of two
+	uint8_t generation;
+	Tt_Pages pages;
+	void *memory; // the mapping buckets sits in, which may start before it
+	size_t memory_size;
+} Tt;
+
+typedef struct {
+	Move move;
+	int score;
+	int depth;
+	Tt_Bound bound;
+} Tt_Data;
+
+// Allocates the largest power of two of buckets that fits in size_mb megabytes, at least one
+void tt_init(Tt *tt, size_t size_mb);
+void tt_free(Tt *tt);
+void tt_clear(Tt *tt);
+// Ages the entries already in the table, to be called at the start of every search
+void tt_new_search(Tt *tt);
+
+bool tt_probe(const Tt *tt, uint64_t key, Tt_Data *data);
+void tt_store(Tt *tt, uint64_t key, Move move, int score, int depth, Tt_Bound bound);
+// Roughly how many of every thousand entries were written by the current search
+int tt_hashfull(const Tt *tt);
+
+static inline size_t tt_size(const Tt *tt) {
+	return (tt->mask + 1)*sizeof(Tt_Bucket);
+}
+
+static inline Tt_Bucket *tt_bucket(const Tt *tt, uint64_t key) {
+	return &tt->buckets[key & tt->mask];
+}
+
+// Called right after a move is made, so the bucket is on its way in while the node gets going
+static inline void tt_prefetch(const Tt *tt, uint64_t key) {
+	__builtin_prefetch(tt_bucket(tt, key));
+}
+
+#endif // TT_H_
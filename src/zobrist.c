@@ -0,0 +1,34 @@
+#include "zobrist.h"
+
+uint64_t zobrist_pieces[ZOBRIST_PIECES][BOARD_LEN];
+uint64_t zobrist_castling[16];
+uint64_t zobrist_double_move[COLS];
+uint64_t zobrist_turn;
+
+// splitmix64, which turns consecutive seeds into well spread 64-bit values
+static uint64_t zobrist_rand(uint64_t *state) {
+	uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+void zobrist_init(void) {
+	uint64_t state = 0x5A0B2157C4E55ull;
+	for (int piece = 0; piece < ZOBRIST_PIECES; ++piece) {
+		// Empty squares and unused packings stay 0, so the mailbox can be hashed byte by byte
+		if (piece_is_empty((Piece){PIECE_PACKED_TYPE(piece), PIECE_PACKED_OWNER(piece)})) continue;
+		for (int sq = 0; sq < BOARD_LEN; ++sq) zobrist_pieces[piece][sq] = zobrist_rand(&state);
+	}
+	// Each right gets its own number and a set of rights is the XOR of them, so losing one right is one XOR
+	uint64_t rights[4];
+	for (int i = 0; i < 4; ++i) rights[i] = zobrist_rand(&state);
+	for (int castling = 0; castling < 16; ++castling) {
+		zobrist_castling[castling] = 0;
+		for (int i = 0; i < 4; ++i) {
+			if (castling & (1 << i)) zobrist_castling[castling] ^= rights[i];
+		}
+	}
+	for (int col = 0; col < COLS; ++col) zobrist_double_move[col] = zobrist_rand(&state);
+	zobrist_turn = zobrist_rand(&state);
+}
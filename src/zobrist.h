@@ -0,0 +1,27 @@
+#ifndef ZOBRIST_H_
+#define ZOBRIST_H_
+
+#include "position.h"
+
+/*
+	A position's key is the XOR of one random number per piece on a square, plus one for the
+	castling rights, one for the file of a double move and one if black is to move. Every change
+	to the position XORs the numbers of what changed in and out, so the key never has to be
+	recomputed. The numbers come from a fixed seed, so keys are the same on every run and machine.
+*/
+#define ZOBRIST_PIECES (OWNER_COUNT << 3) // indexed by the packed piece, as stored in the mailbox
+
+extern uint64_t zobrist_pieces[ZOBRIST_PIECES][BOARD_LEN];
+extern uint64_t zobrist_castling[16];
+extern uint64_t zobrist_double_move[COLS];
+extern uint64_t zobrist_turn;
+
+// Has to be called once before any position is set up
+void zobrist_init(void);
+
+// Everything in the key other than the pieces and the turn
+static inline uint64_t zobrist_state(uint8_t castling, Square double_move) {
+	return zobrist_castling[castling] ^ (double_move == SQUARE_NONE? 0: zobrist_double_move[SQUARE_COL(double_move)]);
+}
+
+#endif // ZOBRIST_H_